@@ -0,0 +1,353 @@
+#include "AnalysisServer.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "MoveCalculator.h"
+
+namespace {
+
+// Connections sending longer lines are closed.
+constexpr size_t kMaxLineLength = 4096;
+
+std::string toUciMove(const Move& move) {
+  std::string result{move.old_square.letter, move.old_square.number,
+                     move.new_square.letter, move.new_square.number};
+  if (move.promotion) {
+    result += static_cast<char>(tolower(move.promotion));
+  }
+  return result;
+}
+
+// Score for the side to move, mates in full moves as in UCI.
+std::string formatScore(bool white_to_move, int score, int moves_to_mate) {
+  const int sign = white_to_move ? 1 : -1;
+  if (moves_to_mate != 0) {
+    // moves_to_mate counts plies plus one.
+    return "mate " + std::to_string(
+        sign * (moves_to_mate > 0 ? 1 : -1) * (std::abs(moves_to_mate) / 2));
+  }
+  return "cp " + std::to_string(sign * score);
+}
+
+bool sendAll(int connection, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t result = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+    sent += result;
+  }
+  return true;
+}
+
+}  // unnamed namespace
+
+constexpr size_t AnalysisServer::kLatencyWindow;
+
+AnalysisServer::AnalysisServer(const Settings& settings)
+  : settings_(settings), evaluation_cache_(std::make_shared<EvaluationCache>()) {
+  latencies_us_.reserve(kLatencyWindow);
+  for (unsigned i = 0; i < std::max(settings_.engines, 1u); ++i) {
+    workers_.emplace_back(&AnalysisServer::worker, this);
+  }
+}
+
+AnalysisServer::~AnalysisServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  job_added_.notify_all();
+  for (auto& worker: workers_) {
+    worker.join();
+  }
+}
+
+std::string AnalysisServer::handle(const std::string& line) {
+  std::istringstream request(line);
+  std::string command;
+  request >> command;
+  if (command == "analyse" || command == "analyze") {
+    std::string arguments;
+    std::getline(request, arguments);
+    return analyse(arguments);
+  } else if (command == "stats") {
+    return formatStatistics();
+  }
+  return "error unknown command";
+}
+
+std::string AnalysisServer::analyse(const std::string& arguments) {
+  const Clock::time_point arrival = Clock::now();
+  std::istringstream fields(arguments);
+  std::string fen;
+  unsigned depth = settings_.depth;
+  unsigned time_ms = settings_.time_ms;
+  unsigned long long nodes = 0ull;
+  bool limits = false;
+  std::string token;
+  while (fields >> token) {
+    if (token == "depth" || token == "nodes" || token == "time") {
+      limits = true;
+      unsigned long long value;
+      if (!(fields >> value)) {
+        return "error invalid " + token;
+      }
+      if (token == "depth") {
+        depth = static_cast<unsigned>(std::max(value, 1ull));
+      } else if (token == "nodes") {
+        nodes = value;
+      } else {
+        time_ms = static_cast<unsigned>(std::min<unsigned long long>(value, UINT32_MAX));
+      }
+    } else if (limits) {
+      return "error unknown limit " + token;
+    } else {
+      fen += (fen.empty() ? "" : " ") + token;
+    }
+  }
+  std::unique_ptr<Job> job;
+  try {
+    job.reset(new Job{Board(fen), depth, nodes, arrival,
+                      arrival + std::chrono::milliseconds(std::min(time_ms, settings_.max_time_ms)),
+                      {}});
+  } catch (Board::InvalidFENException&) {
+    return "error invalid position";
+  }
+  std::future<std::string> reply = job->reply.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return "error stopping";
+    }
+    if (jobs_.size() >= settings_.max_queue) {
+      ++rejected_;
+      return "error busy";
+    }
+    jobs_.push_back(std::move(job));
+  }
+  job_added_.notify_one();
+  return reply.get();
+}
+
+void AnalysisServer::worker() {
+  Engine engine(settings_.depth, settings_.time_ms);
+  // Network first, it clears the engine's own cache.
+  engine.setNetwork(settings_.network);
+  engine.setEvaluationCache(evaluation_cache_);
+  while (true) {
+    std::unique_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_added_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+      ++busy_;
+    }
+    std::string reply = search(engine, *job);
+    const long latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - job->arrival).count();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --busy_;
+      ++requests_;
+      if (latencies_us_.size() < kLatencyWindow) {
+        latencies_us_.push_back(latency_us);
+      } else {
+        latencies_us_[next_latency_] = latency_us;
+      }
+      next_latency_ = (next_latency_ + 1) % kLatencyWindow;
+    }
+    job->reply.set_value(std::move(reply));
+  }
+}
+
+std::string AnalysisServer::search(Engine& engine, Job& job) const {
+  // Time spent in the queue is gone; the root is expanded in any case.
+  const long remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      job.deadline - Clock::now()).count();
+  engine.setDepth(job.depth);
+  engine.setNodesLimit(job.nodes);
+  engine.setTimeForMove(static_cast<unsigned>(std::max(remaining_ms, 1l)));
+  const bool white_to_move = job.board.whiteToMove();
+  // The last completed iteration, if any.
+  std::string score;
+  std::string principal_variation;
+  engine.setIterationCallback([&](Engine::IterationStats stats) {
+    score = formatScore(white_to_move, stats.score, stats.moves_to_mate);
+    principal_variation.clear();
+    for (const Move& move: stats.principal_variation) {
+      principal_variation += (principal_variation.empty() ? "" : " ") + toUciMove(move);
+    }
+  });
+  std::ostringstream reply;
+  engine.setStatsCallback([&](Engine::MoveStats stats) {
+    const std::string best_move = toUciMove(stats.move);
+    // Interrupted iteration may have changed the best move.
+    if (principal_variation.compare(0, best_move.size() + 1, best_move + " ") != 0 &&
+        principal_variation != best_move) {
+      score = formatScore(white_to_move, stats.score, stats.moves_to_mate);
+      principal_variation = best_move;
+    }
+    reply << "bestmove " << best_move << " score " << score << " depth " << stats.depth
+          << " nodes " << stats.nodes << " time " << stats.time_ms
+          << " pv " << principal_variation;
+  });
+  try {
+    engine.calculateBestMove(job.board);
+  } catch (Engine::NoValidMoveException&) {
+    return "error no legal move";
+  } catch (MoveCalculator::InvalidPositionException&) {
+    return "error invalid position";
+  }
+  return reply.str();
+}
+
+AnalysisServer::Statistics AnalysisServer::getStatistics() const {
+  std::vector<long> latencies;
+  Statistics statistics{};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics.queue = jobs_.size();
+    statistics.busy = busy_;
+    statistics.requests = requests_;
+    statistics.rejected = rejected_;
+    latencies = latencies_us_;
+  }
+  if (latencies.empty()) {
+    return statistics;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  // Nearest rank.
+  auto getPercentile = [&latencies](double percentile) {
+    const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * latencies.size()));
+    return latencies[std::max<size_t>(rank, 1) - 1] / 1000.0;
+  };
+  statistics.p50_ms = getPercentile(50.0);
+  statistics.p90_ms = getPercentile(90.0);
+  statistics.p99_ms = getPercentile(99.0);
+  statistics.max_ms = latencies.back() / 1000.0;
+  return statistics;
+}
+
+std::string AnalysisServer::formatStatistics() const {
+  const Statistics statistics = getStatistics();
+  std::ostringstream result;
+  result << std::fixed << std::setprecision(1)
+         << "queue " << statistics.queue << " busy " << statistics.busy
+         << " engines " << workers_.size() << " requests " << statistics.requests
+         << " rejected " << statistics.rejected << " p50 " << statistics.p50_ms
+         << " p90 " << statistics.p90_ms << " p99 " << statistics.p99_ms
+         << " max " << statistics.max_ms;
+  return result.str();
+}
+
+void AnalysisServer::serve(const std::string& path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw SocketException(path, ENAMETOOLONG);
+  }
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  const int listening = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listening < 0) {
+    throw SocketException(path, errno);
+  }
+  // Socket file left by a previous run.
+  unlink(path.c_str());
+  if (bind(listening, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(listening, SOMAXCONN) < 0) {
+    const int error = errno;
+    close(listening);
+    throw SocketException(path, error);
+  }
+  {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    listening_socket_ = listening;
+    serving_stopped_ = false;
+  }
+  while (true) {
+    const int connection = accept(listening, nullptr, nullptr);
+    if (connection < 0 && errno == EINTR) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    if (connection < 0 || serving_stopped_) {
+      if (connection >= 0) {
+        close(connection);
+      }
+      break;
+    }
+    connections_.push_back(connection);
+    std::thread(&AnalysisServer::handleConnection, this, connection).detach();
+  }
+
+  std::unique_lock<std::mutex> lock(connections_mutex_);
+  listening_socket_ = -1;
+  // Connections finish the lines they have already read.
+  for (int connection: connections_) {
+    shutdown(connection, SHUT_RD);
+  }
+  connection_closed_.wait(lock, [this]() { return connections_.empty(); });
+  close(listening);
+  unlink(path.c_str());
+}
+
+void AnalysisServer::stop() {
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  serving_stopped_ = true;
+  if (listening_socket_ >= 0) {
+    // Wakes up accept().
+    shutdown(listening_socket_, SHUT_RDWR);
+  }
+}
+
+void AnalysisServer::handleConnection(int connection) {
+  std::string buffer;
+  char data[kMaxLineLength];
+  bool open = true;
+  while (open) {
+    const ssize_t received = recv(connection, data, sizeof(data), 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      break;
+    }
+    buffer.append(data, received);
+    size_t line_end;
+    while (open && (line_end = buffer.find('\n')) != std::string::npos) {
+      std::string line = buffer.substr(0, line_end);
+      buffer.erase(0, line_end + 1);
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      open = sendAll(connection, handle(line) + "\n");
+    }
+    if (buffer.size() > kMaxLineLength) {
+      sendAll(connection, "error line too long\n");
+      open = false;
+    }
+  }
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  connections_.erase(std::find(connections_.begin(), connections_.end(), connection));
+  close(connection);
+  connection_closed_.notify_all();
+}
@@ -0,0 +1,128 @@
+#ifndef ANALYSIS_SERVER_H
+#define ANALYSIS_SERVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Engine.h"
+
+// Answers analysis requests with a fixed pool of engines, which stay warm
+// between requests and share one evaluation cache. Requests wait in a FIFO
+// queue; time spent there is taken from their search time, so a reply
+// arrives within the requested time whatever the load.
+//
+// Protocol, one line per request and per reply:
+//   analyse <fen> [depth N] [nodes N] [time MS]
+//     -> bestmove <move> score cp|mate N depth N nodes N time MS pv <moves>
+//   stats
+//     -> queue N busy N engines N requests N rejected N p50 MS p90 MS p99 MS max MS
+// Moves are in coordinate notation, scores are given for the side to move
+// and mates in full moves, as in UCI. Failed requests are answered with
+// "error <reason>".
+class AnalysisServer {
+ public:
+  struct SocketException {
+    SocketException(const std::string& p, int e) : path(p), error(e) {}
+    const std::string path;
+    // errno of the failed call.
+    const int error;
+  };
+
+  struct Settings {
+    unsigned engines{std::max(std::thread::hardware_concurrency(), 1u)};
+    // Used when the request does not give them.
+    unsigned depth{64};
+    unsigned time_ms{100};
+    // Requests asking for more are cut to it.
+    unsigned max_time_ms{10000};
+    // Requests arriving when this many are waiting are rejected at once.
+    size_t max_queue{1024};
+    std::shared_ptr<const Nnue> network;
+  };
+
+  // Latencies from arrival of a request to its reply, of the last
+  // kLatencyWindow analysed requests.
+  struct Statistics {
+    size_t queue;
+    size_t busy;
+    unsigned long long requests;
+    unsigned long long rejected;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+  };
+
+  static constexpr size_t kLatencyWindow = 4096;
+
+  AnalysisServer(const Settings& settings);
+  // Answers the waiting requests. serve() has to return before.
+  ~AnalysisServer();
+
+  AnalysisServer(const AnalysisServer&) = delete;
+  AnalysisServer& operator=(const AnalysisServer&) = delete;
+
+  // Reply to one request line; blocks until it is analysed.
+  // May be called from any thread.
+  std::string handle(const std::string& line);
+
+  // Accepts connections on Unix socket |path| until stop(). Lines of one
+  // connection are answered in order, connections in parallel.
+  void serve(const std::string& path);
+  // Makes a running serve() return once replies to the lines already
+  // received are sent. May be called from any thread.
+  void stop();
+
+  Statistics getStatistics() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    Board board;
+    unsigned depth;
+    unsigned long long nodes;
+    Clock::time_point arrival;
+    Clock::time_point deadline;
+    std::promise<std::string> reply;
+  };
+
+  std::string analyse(const std::string& arguments);
+  std::string search(Engine& engine, Job& job) const;
+  std::string formatStatistics() const;
+  void worker();
+  void handleConnection(int connection);
+
+  const Settings settings_;
+  std::shared_ptr<EvaluationCache> evaluation_cache_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable job_added_;
+  std::deque<std::unique_ptr<Job>> jobs_;
+  bool stopping_{false};
+  size_t busy_{0};
+  unsigned long long requests_{0ull};
+  unsigned long long rejected_{0ull};
+  // Ring of the last kLatencyWindow latencies in microseconds.
+  std::vector<long> latencies_us_;
+  size_t next_latency_{0};
+  std::vector<std::thread> workers_;
+
+  std::mutex connections_mutex_;
+  std::condition_variable connection_closed_;
+  int listening_socket_{-1};
+  bool serving_stopped_{false};
+  // Open connections, each served by a detached thread.
+  std::vector<int> connections_;
+};
+
+#endif  // ANALYSIS_SERVER_H
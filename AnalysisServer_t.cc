@@ -0,0 +1,149 @@
+/* Component tests for class AnalysisServer */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisServer.h"
+#include "utils/Test.h"
+
+namespace {
+
+const std::string kSocketPath = "/tmp/analysis_server_tests.sock";
+
+bool startsWith(const std::string& text, const std::string& prefix) {
+  return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+AnalysisServer::Settings createSettings(unsigned engines) {
+  AnalysisServer::Settings settings;
+  settings.engines = engines;
+  settings.time_ms = 5000;
+  return settings;
+}
+
+// Connects to the server, retrying while it is starting.
+int connectToServer() {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, kSocketPath.c_str(), kSocketPath.size() + 1);
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+      return connection;
+    }
+    close(connection);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return -1;
+}
+
+// Reads |lines| lines, or less if the connection is closed.
+std::vector<std::string> readLines(int connection, size_t lines) {
+  std::vector<std::string> result;
+  std::string line;
+  char c;
+  while (result.size() < lines && recv(connection, &c, 1, 0) == 1) {
+    if (c == '\n') {
+      result.push_back(line);
+      line.clear();
+    } else {
+      line += c;
+    }
+  }
+  return result;
+}
+
+TEST_PROCEDURE(AnalysisServer_answers_requests) {
+  TEST_START
+  AnalysisServer server(createSettings(2));
+  VERIFY_TRUE(startsWith(server.handle("analyse 8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1 depth 2"),
+                         "bestmove d6e5 score cp 0 depth 2 "));
+  // Mate in one for white, given in moves.
+  const std::string mate = server.handle("analyse 5k2/8/5K2/8/8/8/8/R7 w - - 0 1 depth 3");
+  VERIFY_TRUE(startsWith(mate, "bestmove a1a8 score mate 1 "));
+  VERIFY_TRUE(mate.find(" pv a1a8") != std::string::npos);
+  const std::string line = server.handle(
+      "analyse r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3 depth 3");
+  VERIFY_TRUE(startsWith(line, "bestmove "));
+  // Principal variation starts with the best move and is 3 plies long.
+  const size_t pv = line.find(" pv ");
+  VERIFY_TRUE(pv != std::string::npos);
+  VERIFY_TRUE(line.compare(pv + 4, 4, line.substr(9, 4)) == 0);
+  VERIFY_EQUALS(std::count(line.begin() + pv, line.end(), ' '), 4l);
+
+  VERIFY_EQUALS(server.handle("analyse 8/8/8 w"), std::string("error invalid position"));
+  VERIFY_EQUALS(server.handle("analyse 5k2/5Q2/5K2/8/8/8/8/8 b - - 0 1"),
+                std::string("error no legal move"));
+  VERIFY_EQUALS(server.handle("analyse 8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1 depth x"),
+                std::string("error invalid depth"));
+  VERIFY_EQUALS(server.handle("hello"), std::string("error unknown command"));
+  VERIFY_TRUE(startsWith(server.handle("stats"),
+                         "queue 0 busy 0 engines 2 requests 4 rejected 0 p50 "));
+  TEST_END
+}
+
+TEST_PROCEDURE(AnalysisServer_meets_deadlines_under_burst) {
+  TEST_START
+  constexpr size_t kRequests = 64;
+  std::vector<std::string> replies(kRequests);
+  {
+    AnalysisServer server(createSettings(2));
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < kRequests; ++i) {
+      clients.emplace_back([&server, &replies, i]() {
+        replies[i] = server.handle(
+            "analyse r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3 time 50");
+      });
+    }
+    for (auto& client: clients) {
+      client.join();
+    }
+    const AnalysisServer::Statistics statistics = server.getStatistics();
+    VERIFY_EQUALS(statistics.requests, kRequests);
+    // Requests waiting in the queue search only for the rest of their time.
+    VERIFY_TRUE(statistics.max_ms < 1000.0);
+    VERIFY_TRUE(statistics.p50_ms <= statistics.p99_ms);
+  }
+  for (const std::string& reply: replies) {
+    VERIFY_TRUE(startsWith(reply, "bestmove "));
+  }
+
+  AnalysisServer::Settings settings = createSettings(1);
+  settings.max_queue = 0;
+  AnalysisServer server(settings);
+  VERIFY_EQUALS(server.handle("analyse 8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1"), std::string("error busy"));
+  VERIFY_EQUALS(server.getStatistics().rejected, 1ull);
+  TEST_END
+}
+
+TEST_PROCEDURE(AnalysisServer_serves_unix_socket) {
+  TEST_START
+  AnalysisServer server(createSettings(2));
+  std::thread serving([&server]() { server.serve(kSocketPath); });
+  const int connection = connectToServer();
+  VERIFY_TRUE(connection >= 0);
+  const std::string requests =
+      "analyse 8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1 depth 2\r\nstats\n";
+  VERIFY_EQUALS(send(connection, requests.data(), requests.size(), 0),
+                static_cast<ssize_t>(requests.size()));
+  const std::vector<std::string> replies = readLines(connection, 2);
+  VERIFY_EQUALS(replies.size(), 2lu);
+  VERIFY_TRUE(startsWith(replies[0], "bestmove d6e5 "));
+  VERIFY_TRUE(startsWith(replies[1], "queue 0 busy 0 engines 2 requests 1 "));
+  server.stop();
+  serving.join();
+  // Connection is closed by the server.
+  VERIFY_EQUALS(readLines(connection, 1).size(), 0lu);
+  close(connection);
+  VERIFY_TRUE(access(kSocketPath.c_str(), F_OK) != 0);
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Engine.h"
+#include "MappedFile.h"
+#include "MoveCalculator.h"
+
+namespace {
+
+struct AnalysisSettings {
+  std::string input_path;
+  std::string output_path;
+  unsigned threads{std::max(std::thread::hardware_concurrency(), 1u)};
+  unsigned depth{6};
+  unsigned long long nodes{0ull};
+  unsigned time_for_move_ms{60000};
+  std::string network_path;
+  // Loaded from network_path, shared by all workers.
+  std::shared_ptr<const Nnue> network;
+};
+
+// Builds a FEN from an EPD or FEN line. EPD operations are dropped,
+// missing move counters are replaced with "0 1".
+std::string createFEN(const std::string& line) {
+  std::istringstream fields(line);
+  std::string field;
+  std::string fen;
+  for (int i = 0; i < 4 && fields >> field; ++i) {
+    fen += (i > 0 ? " " : "") + field;
+  }
+  std::string halfmove_clock;
+  std::string fullmove_number;
+  fields >> halfmove_clock >> fullmove_number;
+  const bool has_counters =
+      !halfmove_clock.empty() && !fullmove_number.empty() &&
+      std::all_of(halfmove_clock.begin(), halfmove_clock.end(), ::isdigit) &&
+      std::all_of(fullmove_number.begin(), fullmove_number.end(), ::isdigit);
+  return has_counters ? fen + " " + halfmove_clock + " " + fullmove_number : fen + " 0 1";
+}
+
+// Result is written as an EPD record: position followed by
+// bm (best move), ce (centipawns for the side to move), acd (depth) and acn (nodes).
+std::string analysePosition(const AnalysisSettings& settings, const std::string& line) {
+  const std::string fen = createFEN(line);
+  std::istringstream fields(line);
+  std::string record;
+  std::string field;
+  for (int i = 0; i < 4 && fields >> field; ++i) {
+    record += (i > 0 ? " " : "") + field;
+  }
+  std::ostringstream result;
+  result << record;
+  try {
+    Board board(fen);
+    Engine engine(settings.depth, settings.time_for_move_ms);
+    engine.setNodesLimit(settings.nodes);
+    engine.setNetwork(settings.network);
+    engine.setStatsCallback([&board, &result](Engine::MoveStats stats) {
+      const int sign = board.whiteToMove() ? 1 : -1;
+      result << " bm " << stats.move << ";";
+      if (stats.moves_to_mate != 0) {
+        // Full moves to mate, negative when the side to move gets mated.
+        const int moves_to_mate = sign * stats.moves_to_mate;
+        result << " dm " << (moves_to_mate > 0 ? moves_to_mate / 2 : -(-moves_to_mate / 2)) << ";";
+      } else {
+        result << " ce " << sign * stats.score << ";";
+      }
+      result << " acd " << stats.depth << "; acn " << stats.nodes << ";";
+    });
+    engine.calculateBestMove(board);
+  } catch (Board::InvalidFENException&) {
+    result << " c0 \"invalid position\";";
+  } catch (MoveCalculator::InvalidPositionException&) {
+    result << " c0 \"invalid position\";";
+  } catch (Engine::NoValidMoveException&) {
+    const bool is_check = MoveCalculator(Board(fen)).isCheck();
+    result << " c0 \"" << (is_check ? "checkmate" : "stalemate") << "\";";
+  }
+  return result.str();
+}
+
+// Positions are handed out to workers in input order; results are buffered
+// until all preceding ones are written, at most |window| positions ahead.
+class BatchAnalysis {
+ public:
+  BatchAnalysis(const AnalysisSettings& settings, const MappedFile& input, std::ostream& output)
+    : settings_(settings), output_(output), window_(settings.threads * 64) {
+    const char* data = reinterpret_cast<const char*>(input.data());
+    const char* end = data + input.size();
+    while (data < end) {
+      const char* line_end = static_cast<const char*>(memchr(data, '\n', end - data));
+      if (!line_end) {
+        line_end = end;
+      }
+      const char* trimmed_end = line_end;
+      while (trimmed_end > data && isspace(static_cast<unsigned char>(trimmed_end[-1]))) {
+        --trimmed_end;
+      }
+      if (trimmed_end > data && data[0] != '#') {
+        lines_.emplace_back(data, trimmed_end - data);
+      }
+      data = line_end + 1;
+    }
+  }
+
+  // Returns number of analysed positions.
+  size_t run();
+
+ private:
+  void worker();
+
+  const AnalysisSettings& settings_;
+  std::ostream& output_;
+  const size_t window_;
+  std::vector<std::pair<const char*, size_t>> lines_;
+  std::atomic<size_t> next_position_{0};
+  size_t next_to_write_{0};
+  std::map<size_t, std::string> pending_results_;
+  std::mutex mutex_;
+  std::condition_variable window_moved_;
+};
+
+void BatchAnalysis::worker() {
+  while (true) {
+    const size_t index = next_position_++;
+    if (index >= lines_.size()) {
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      window_moved_.wait(lock, [this, index]() { return index < next_to_write_ + window_; });
+    }
+    const std::string line(lines_[index].first, lines_[index].second);
+    std::string result = analysePosition(settings_, line);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_results_.emplace(index, std::move(result));
+    bool written = false;
+    for (auto it = pending_results_.begin();
+         it != pending_results_.end() && it->first == next_to_write_;
+         it = pending_results_.erase(it)) {
+      output_ << it->second << '\n';
+      ++next_to_write_;
+      written = true;
+    }
+    if (written) {
+      output_.flush();
+      window_moved_.notify_all();
+    }
+  }
+}
+
+size_t BatchAnalysis::run() {
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < settings_.threads; ++i) {
+    threads.emplace_back(&BatchAnalysis::worker, this);
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  return lines_.size();
+}
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [options] <input.epd>" << std::endl
+            << "  --threads N    positions analysed at once (all cores)" << std::endl
+            << "  --depth N      search depth (6)" << std::endl
+            << "  --nodes N      node budget per position, 0 means no limit (0)" << std::endl
+            << "  --time MS      time limit per position (60000)" << std::endl
+            << "  --output FILE  EPD output (stdout)" << std::endl
+            << "  --network FILE evaluation network (material)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], AnalysisSettings& settings) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option.compare(0, 2, "--") != 0) {
+      if (!settings.input_path.empty()) {
+        return false;
+      }
+      settings.input_path = option;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::istringstream value(argv[++i]);
+    if (option == "--threads") {
+      value >> settings.threads;
+    } else if (option == "--depth") {
+      value >> settings.depth;
+    } else if (option == "--nodes") {
+      value >> settings.nodes;
+    } else if (option == "--time") {
+      value >> settings.time_for_move_ms;
+    } else if (option == "--output") {
+      value >> settings.output_path;
+    } else if (option == "--network") {
+      value >> settings.network_path;
+    } else {
+      return false;
+    }
+    if (!value) {
+      return false;
+    }
+  }
+  return !settings.input_path.empty() && settings.threads > 0;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  AnalysisSettings settings;
+  if (!parseArguments(argc, argv, settings)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  std::ofstream output_file;
+  if (!settings.output_path.empty()) {
+    output_file.open(settings.output_path);
+    if (!output_file) {
+      std::cerr << "Cannot open " << settings.output_path << std::endl;
+      return 1;
+    }
+  }
+  try {
+    if (!settings.network_path.empty()) {
+      settings.network = std::make_shared<Nnue>(settings.network_path);
+    }
+    MappedFile input(settings.input_path);
+    auto start_time = std::chrono::steady_clock::now();
+    BatchAnalysis analysis(settings, input, settings.output_path.empty() ? std::cout : output_file);
+    const size_t positions = analysis.run();
+    auto time_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cerr << "Analysed " << positions << " positions in " << time_elapsed << " ms ("
+              << (time_elapsed > 0 ? positions * 1000.0 / time_elapsed : 0.0)
+              << " positions/s)" << std::endl;
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+    return 1;
+  } catch (Nnue::InvalidNetworkException& e) {
+    std::cerr << "Invalid network " << e.path << std::endl;
+    return 1;
+  }
+  return 0;
+}
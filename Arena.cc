@@ -0,0 +1,38 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+void* Arena::allocateBytes(size_t bytes, size_t alignment) {
+  while (current_block_ < blocks_.size()) {
+    Block& block = blocks_[current_block_];
+    const uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get()) + offset_;
+    const size_t padding = (alignment - address % alignment) % alignment;
+    if (offset_ + padding + bytes <= block.size) {
+      offset_ += padding + bytes;
+      return block.data.get() + offset_ - bytes;
+    }
+    ++current_block_;
+    offset_ = 0;
+  }
+  // Blocks are allocated with operator new[], so they are aligned for any fundamental type.
+  const size_t size = std::max(block_size_, bytes);
+  blocks_.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+  current_block_ = blocks_.size() - 1;
+  offset_ = bytes;
+  return blocks_.back().data.get();
+}
+
+void Arena::reset() {
+  current_block_ = 0;
+  offset_ = 0;
+}
+
+size_t Arena::getUsedBytes() const {
+  size_t result = offset_;
+  for (size_t i = 0; i < current_block_ && i < blocks_.size(); ++i) {
+    result += blocks_[i].size;
+  }
+  return result;
+}
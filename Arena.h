@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for objects released all at once. Objects are not
+// destroyed, so only trivially destructible types may be allocated.
+class Arena {
+ public:
+  static constexpr size_t kDefaultBlockSize = 1u << 20;
+
+  Arena(size_t block_size = kDefaultBlockSize) : block_size_(block_size) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Uninitialized storage for |count| objects of type T.
+  template <typename T>
+  T* allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Arena never calls destructors");
+    return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+  }
+
+  // Releases all allocated objects. Memory is kept for next allocations.
+  void reset();
+
+  size_t getUsedBytes() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> data;
+    size_t size;
+  };
+
+  void* allocateBytes(size_t bytes, size_t alignment);
+
+  const size_t block_size_;
+  std::vector<Block> blocks_;
+  size_t current_block_{0};
+  size_t offset_{0};
+};
+
+#endif  // ARENA_H
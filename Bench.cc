@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Board.h"
+#include "Engine.h"
+
+namespace {
+
+constexpr unsigned kDefaultDepth = 3;
+constexpr unsigned kRandomSeed = 20;
+// Search has to be limited by depth only, otherwise node count is not reproducible.
+constexpr unsigned kTimeForMoveMs = 24 * 60 * 60 * 1000;
+
+// Openings, middlegames and endgames, including castling, en passant and promotions.
+const char* const kPositions[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+  "1k1r4/pp1b1R2/3q2pp/4p3/2B5/4Q3/PPP2B2/2K5 b - - 0 1",
+  "3r1k2/4npp1/1ppr3p/p6P/P2PPPP1/1NR5/5K2/2R5 w - - 0 1",
+  "2q1rr1k/3bbnnp/p2p1pp1/2pPp3/PpP1P1P1/1P2BNNP/2BQ1PRK/7R b - - 0 1",
+  "rnbqkb1r/p3pppp/1p6/2ppP3/3N4/2P5/PPP1QPPP/R1B1KB1R w KQkq - 0 1",
+  "r1b2rk1/2q1b1pp/p2ppn2/1p6/3QP3/1BN1B3/PPP3PP/R4RK1 w - - 0 1",
+  "2r3k1/pppR1pp1/4p3/4P1P1/5P2/1P4K1/P1P5/8 w - - 0 1",
+  "1nk1r1r1/pp2n1pp/4p3/q2pPp1N/b1pP1P2/B1P2R2/2P1B1PP/R2Q2K1 w - - 0 1",
+  "4b3/p3kp2/6p1/3pP2p/2pP1P2/4K1P1/P3N2P/8 w - - 0 1",
+  "2kr1bnr/pbpq4/2n1pp2/3p3p/3P1P1B/2N2N1Q/PPP3PP/2KR1B1R w - - 0 1",
+  "3rr1k1/pp3pp1/1qn2np1/8/3p4/PP1R1P2/2P1NQPP/R1B3K1 b - - 0 1",
+  "2r1nrk1/p2q1ppp/bp1p4/n1pPp3/P1P1P3/2PBB1N1/4QPPP/R4RK1 w - - 0 1",
+  "r3r1k1/ppqb1ppp/8/4p1NQ/8/2P5/PP3PPP/R3R1K1 b - - 0 1",
+  "r2q1rk1/4bppp/p2p4/2pP4/3pP3/3Q4/PP1B1PPP/R3R1K1 w - - 0 1",
+  "rnb2r1k/pp2p2p/2pp2p1/q2P1p2/8/1Pb2NP1/PB2PPBP/R2Q1RK1 w - - 0 1",
+  "2r3k1/1p2q1pp/2b1pr2/p1pp4/6Q1/1P1PP1R1/P1PN2PP/5RK1 w - - 0 1",
+  "r1bqkb1r/4npp1/p1p4p/1p1pP1B1/8/1B6/PPPN1PPP/R2Q1RK1 w kq - 0 1",
+  "r2q1rk1/1ppnbppp/p2p1nb1/3Pp3/2P1P1P1/2N2N1P/PPB1QP2/R1B2RK1 b - - 0 1",
+  "r1bq1rk1/pp2ppbp/2np2p1/2n5/P3PP2/N1P2N2/1PB3PP/R1B1QRK1 b - - 0 1",
+  "3rr3/2pq2pk/p2p1pnp/8/2QBPP2/1P6/P5PP/4RRK1 b - - 0 1",
+  "r4k2/pb2bp1r/1p1qp2p/3pNp2/3P1P2/2N3P1/PPP1Q2P/2KRR3 w - - 0 1",
+  "3rn2k/ppb2rpp/2ppqp2/5N2/2P1P3/1P5Q/PB3PPP/3RR1K1 w - - 0 1",
+  "2r2rk1/1bqnbpp1/1p1ppn1p/pP6/N1P1P3/P2B1N1P/1B2QPP1/R2R2K1 b - - 0 1",
+  "r1bqk2r/pp2bppp/2p5/3pP3/P2Q1P2/2N1B3/1PP3PP/R4RK1 b kq - 0 1",
+  "r2qnrnk/p2b2b1/1p1p2pp/2pPpp2/1PP1P3/PRNBB3/3QNPPP/5RK1 w - - 0 1",
+  "2k5/8/8/8/8/8/8/4K2R w K - 0 1",
+  "8/8/1p1r1k2/p1pPN1p1/P3KnP1/1P6/8/3R4 b - - 0 1",
+  "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+  "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+  "6kq/8/8/8/8/8/8/7K w - - 0 1",
+  "8/8/8/2k5/2pP4/8/B7/4K3 b - d3 0 1",
+  "K1k5/8/P7/8/8/8/8/8 w - - 0 1",
+  "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+  "8/p7/8/1P6/K1k3p1/6P1/7P/8 w - - 0 1",
+  "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+  "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+  "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
+  "4k3/1P6/8/8/8/8/K7/8 w - - 0 1",
+  "8/P1k5/K7/8/8/8/8/8 w - - 0 1",
+  "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+  "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 0 4",
+  "r1bqk2r/pppp1ppp/2n2n2/2b1p3/2B1P3/3P1N2/PPP2PPP/RNBQK2R w KQkq - 1 5",
+  "rnbqkb1r/ppp2ppp/4pn2/3p2B1/2PP4/2N5/PP2PPPP/R2QKBNR b KQkq - 1 4",
+  "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 10",
+  "8/8/8/8/8/8/6k1/4K2R w K - 0 1",
+};
+
+}  // unnamed namespace
+
+// Searches every position of the suite to a fixed depth with a fresh engine.
+// Total number of nodes is a signature of search behaviour: it changes only
+// when the search itself changes, not with speed of the build or machine.
+int main(int argc, char* argv[]) {
+  unsigned depth = kDefaultDepth;
+  if (argc > 2 || (argc == 2 && (depth = std::atoi(argv[1])) == 0)) {
+    std::cerr << "Usage: " << argv[0] << " [depth]" << std::endl;
+    return 1;
+  }
+
+  unsigned long long total_nodes = 0ull;
+  long total_time_ms = 0;
+  for (const char* fen: kPositions) {
+    Engine engine(depth, kTimeForMoveMs);
+    engine.setRandomSeed(kRandomSeed);
+    engine.setStatsCallback([&total_nodes, &total_time_ms](Engine::MoveStats stats) {
+      total_nodes += stats.nodes;
+      total_time_ms += stats.time_ms;
+    });
+    engine.calculateBestMove(Board(fen));
+  }
+  std::cout << "Positions: " << sizeof(kPositions) / sizeof(kPositions[0]) << std::endl
+            << "Depth: " << depth << std::endl
+            << "Nodes: " << total_nodes << std::endl
+            << "Time: " << total_time_ms << " ms" << std::endl
+            << "Nodes/second: "
+            << (total_time_ms > 0 ? total_nodes * 1000 / total_time_ms : 0ull) << std::endl;
+  return 0;
+}
@@ -0,0 +1,226 @@
+#include "Bitbase.h"
+
+#include <cstring>
+#include <fstream>
+
+
+namespace {
+
+constexpr char kEmptyBoardFen[] = "8/8/8/8/8/8/8/8 w - - 0 1";
+constexpr char kFiguresOrder[] = "QRBNP";
+constexpr size_t kVersionOffset = 4;
+constexpr size_t kNumberOfPiecesOffset = 5;
+constexpr size_t kMaterialOffset = 6;
+constexpr char kVersion = 1;
+constexpr size_t kNumberOfSquares = Board::kBoardSize * Board::kBoardSize;
+
+char toBlack(char figure) {
+  return figure - 'A' + 'a';
+}
+
+char swapColor(char figure) {
+  return figure >= 'a' ? figure - 'a' + 'A' : figure - 'A' + 'a';
+}
+
+// "KQK" -> "KQk": figures as they stand on the board, white ones first.
+std::string getFigures(const std::string& material) {
+  std::string figures = material;
+  const size_t black_king = material.find('K', 1);
+  for (size_t i = black_king; i < figures.size(); ++i) {
+    figures[i] = toBlack(figures[i]);
+  }
+  return figures;
+}
+
+std::string mirrorMaterial(const std::string& material) {
+  const size_t black_king = material.find('K', 1);
+  if (black_king == std::string::npos) {
+    return material;
+  }
+  return material.substr(black_king) + material.substr(0, black_king);
+}
+
+Board mirrorBoard(const Board& board) {
+  Board mirrored(kEmptyBoardFen);
+  for (size_t line = 0; line < Board::kBoardSize; ++line) {
+    for (size_t row = 0; row < Board::kBoardSize; ++row) {
+      const char figure = board.at(line, row);
+      if (figure) {
+        mirrored.at(line, Board::kBoardSize - 1 - row) = swapColor(figure);
+      }
+    }
+  }
+  if (board.whiteToMove()) {
+    mirrored.changeSideToMove();
+  }
+  return mirrored;
+}
+
+}  // unnamed namespace
+
+
+constexpr char Bitbase::kMagic[];
+
+Bitbase::Bitbase(const std::string& path) : file_(path) {
+  if (file_.size() < kHeaderSize ||
+      memcmp(file_.data(), kMagic, 4) != 0 ||
+      file_.data()[kVersionOffset] != kVersion) {
+    throw InvalidBitbaseException(path);
+  }
+  const size_t number_of_pieces = file_.data()[kNumberOfPiecesOffset];
+  if (number_of_pieces > kMaxPieces) {
+    throw InvalidBitbaseException(path);
+  }
+  material_.assign(reinterpret_cast<const char*>(file_.data()) + kMaterialOffset,
+                   number_of_pieces);
+  try {
+    validateMaterial(material_);
+  } catch (InvalidMaterialException&) {
+    throw InvalidBitbaseException(path);
+  }
+  if (file_.size() != kHeaderSize + getNumberOfPositions(material_)) {
+    throw InvalidBitbaseException(path);
+  }
+}
+
+bool Bitbase::probe(const Board& board, int& value) const {
+  size_t index;
+  if (calculateIndex(material_, board, index) == false) {
+    return false;
+  }
+  value = static_cast<int8_t>(file_.data()[kHeaderSize + index]);
+  return true;
+}
+
+void Bitbase::validateMaterial(const std::string& material) {
+  if (material.size() < 2 || material.size() > kMaxPieces || material[0] != 'K') {
+    throw InvalidMaterialException(material);
+  }
+  const size_t black_king = material.find('K', 1);
+  if (black_king == std::string::npos || material.find('K', black_king + 1) != std::string::npos) {
+    throw InvalidMaterialException(material);
+  }
+  // Pieces of each side have to be given in order QRBNP.
+  auto validateSide = [&material](size_t first, size_t last) {
+    const char* previous = kFiguresOrder;
+    for (size_t i = first; i < last; ++i) {
+      const char* position = strchr(kFiguresOrder, material[i]);
+      if (material[i] == 0x0 || position == nullptr || position < previous) {
+        throw InvalidMaterialException(material);
+      }
+      previous = position;
+    }
+  };
+  validateSide(1, black_king);
+  validateSide(black_king + 1, material.size());
+}
+
+size_t Bitbase::getNumberOfPositions(const std::string& material) {
+  size_t result = 2;
+  for (size_t i = 0; i < material.size(); ++i) {
+    result *= kNumberOfSquares;
+  }
+  return result;
+}
+
+std::string Bitbase::getMaterial(const Board& board) {
+  std::string white = "K";
+  std::string black = "K";
+  for (const char* figure = kFiguresOrder; *figure; ++figure) {
+    for (size_t line = 0; line < Board::kBoardSize; ++line) {
+      for (size_t row = 0; row < Board::kBoardSize; ++row) {
+        if (board.at(line, row) == *figure) {
+          white += *figure;
+        } else if (board.at(line, row) == toBlack(*figure)) {
+          black += *figure;
+        }
+      }
+    }
+  }
+  return white + black;
+}
+
+bool Bitbase::isSufficientMaterial(const std::string& material) {
+  if (material.find_first_of("QRP") != std::string::npos) {
+    return true;
+  }
+  // The same rules as in MoveCalculator: bishop with any other minor
+  // piece of the same side is enough to mate.
+  const size_t black_king = material.find('K', 1);
+  auto sideCanMate = [&material](size_t first, size_t last) {
+    const std::string side = material.substr(first, last - first);
+    return side.find('B') != std::string::npos && side.size() >= 2;
+  };
+  return sideCanMate(1, black_king) || sideCanMate(black_king + 1, material.size());
+}
+
+bool Bitbase::calculateIndex(const std::string& material, const Board& board, size_t& index) {
+  if (board.canCastle(Castling::K) || board.canCastle(Castling::Q) ||
+      board.canCastle(Castling::k) || board.canCastle(Castling::q) ||
+      board.isEnPassantCapturePossible()) {
+    return false;
+  }
+  const std::string board_material = getMaterial(board);
+  if (board_material != material) {
+    if (mirrorMaterial(board_material) != material) {
+      return false;
+    }
+    return calculateIndex(material, mirrorBoard(board), index);
+  }
+
+  const std::string figures = getFigures(material);
+  std::vector<bool> used(kNumberOfSquares, false);
+  index = 0;
+  for (const char figure: figures) {
+    for (size_t square = 0; square < kNumberOfSquares; ++square) {
+      const size_t line = square % Board::kBoardSize;
+      const size_t row = square / Board::kBoardSize;
+      if (used[square] == false && board.at(line, row) == figure) {
+        used[square] = true;
+        index = index * kNumberOfSquares + square;
+        break;
+      }
+    }
+  }
+  index = index * 2 + (board.whiteToMove() ? 0 : 1);
+  return true;
+}
+
+bool Bitbase::createBoard(const std::string& material, size_t index, Board& board) {
+  board = Board(kEmptyBoardFen);
+  if (index % 2 == 1) {
+    board.changeSideToMove();
+  }
+  index /= 2;
+  const std::string figures = getFigures(material);
+  for (size_t i = figures.size(); i > 0; --i) {
+    const size_t square = index % kNumberOfSquares;
+    index /= kNumberOfSquares;
+    const size_t row = square / Board::kBoardSize;
+    char& target = board.at(square % Board::kBoardSize, row);
+    const bool is_pawn = figures[i - 1] == 'P' || figures[i - 1] == 'p';
+    if (target || (is_pawn && (row == 0 || row == Board::kBoardSize - 1))) {
+      return false;
+    }
+    target = figures[i - 1];
+  }
+  return true;
+}
+
+void Bitbase::write(const std::string& path,
+                    const std::string& material,
+                    const std::vector<int8_t>& values) {
+  validateMaterial(material);
+  assert(values.size() == getNumberOfPositions(material));
+  char header[kHeaderSize] = {0};
+  memcpy(header, kMagic, 4);
+  header[kVersionOffset] = kVersion;
+  header[kNumberOfPiecesOffset] = static_cast<char>(material.size());
+  memcpy(header + kMaterialOffset, material.data(), material.size());
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(header, kHeaderSize);
+  file.write(reinterpret_cast<const char*>(values.data()), values.size());
+  if (!file) {
+    throw InvalidBitbaseException(path);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "MappedFile.h"
+
+// Endgame table with distance to mate for every position of one material
+// set, e.g. "KQK" (white pieces first, then black ones). Positions with
+// colors swapped are served by the same table.
+//
+// Values are given from the side to move point of view: 0 is a draw,
+// positive value means that side to move mates, negative that it gets
+// mated. Absolute value is number of plies to the mate plus one, so that
+// it matches Engine's moves-to-mate convention (mated position is -1).
+class Bitbase {
+ public:
+  struct InvalidBitbaseException {
+    InvalidBitbaseException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  struct InvalidMaterialException {
+    InvalidMaterialException(const std::string& m) : material(m) {}
+    const std::string material;
+  };
+
+  static constexpr size_t kMaxPieces = 3;
+  static constexpr size_t kHeaderSize = 16;
+  static constexpr char kMagic[] = "CKBB";
+
+  Bitbase(const std::string& path);
+
+  const std::string& getMaterial() const {
+    return material_;
+  }
+
+  // Returns false if |board| does not belong to this table.
+  bool probe(const Board& board, int& value) const;
+
+  static void validateMaterial(const std::string& material);
+  static size_t getNumberOfPositions(const std::string& material);
+  static std::string getMaterial(const Board& board);
+  static bool isSufficientMaterial(const std::string& material);
+
+  // Index of |board| in table for |material|, mirroring colors if needed.
+  // Returns false if the position cannot be stored in such table.
+  static bool calculateIndex(const std::string& material, const Board& board, size_t& index);
+
+  // Places pieces of |material| as encoded in |index|. Returns false
+  // if two pieces would stand on the same square or a pawn would stand
+  // on the first or the last rank.
+  static bool createBoard(const std::string& material, size_t index, Board& board);
+
+  static void write(const std::string& path,
+                    const std::string& material,
+                    const std::vector<int8_t>& values);
+
+ private:
+  MappedFile file_;
+  std::string material_;
+};
+
+#endif  // BITBASE_H
@@ -0,0 +1,222 @@
+#include "BitbaseGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+namespace {
+
+constexpr char kEmptyBoardFen[] = "8/8/8/8/8/8/8/8 w - - 0 1";
+constexpr char kFiguresOrder[] = "QRBNP";
+constexpr int kMaxValue = 127;
+
+std::string sortSide(std::string side) {
+  std::sort(side.begin(), side.end(), [](char a, char b) {
+    return strchr(kFiguresOrder, a) < strchr(kFiguresOrder, b);
+  });
+  return side;
+}
+
+// Keeps the stronger side as white so that each material set
+// is generated only once.
+std::string normalizeMaterial(const std::string& white, const std::string& black) {
+  const std::string sorted_white = sortSide(white);
+  const std::string sorted_black = sortSide(black);
+  if (sorted_white.size() < sorted_black.size()) {
+    return "K" + sorted_black + "K" + sorted_white;
+  }
+  return "K" + sorted_white + "K" + sorted_black;
+}
+
+}  // unnamed namespace
+
+
+BitbaseGenerator::BitbaseGenerator(unsigned number_of_threads)
+  : number_of_threads_(std::max(number_of_threads, 1u)) {
+}
+
+std::vector<std::string> BitbaseGenerator::getDependencies(const std::string& material) const {
+  const size_t black_king = material.find('K', 1);
+  const std::string white = material.substr(1, black_king - 1);
+  const std::string black = material.substr(black_king + 1);
+  std::vector<std::string> dependencies;
+  auto addDependency = [&dependencies](const std::string& white, const std::string& black) {
+    const std::string dependency = normalizeMaterial(white, black);
+    if (Bitbase::isSufficientMaterial(dependency)) {
+      dependencies.push_back(dependency);
+    }
+  };
+  for (size_t i = 0; i < white.size(); ++i) {
+    std::string rest = white;
+    rest.erase(i, 1);
+    addDependency(rest, black);
+    if (white[i] == 'P') {
+      for (const char promotion: std::string("QRBN")) {
+        rest = white;
+        rest[i] = promotion;
+        addDependency(rest, black);
+      }
+    }
+  }
+  for (size_t i = 0; i < black.size(); ++i) {
+    std::string rest = black;
+    rest.erase(i, 1);
+    addDependency(white, rest);
+    if (black[i] == 'P') {
+      for (const char promotion: std::string("QRBN")) {
+        rest = black;
+        rest[i] = promotion;
+        addDependency(white, rest);
+      }
+    }
+  }
+  return dependencies;
+}
+
+int BitbaseGenerator::probeTables(const Move& move) const {
+  const std::string material = Bitbase::getMaterial(move.board);
+  for (const auto& table: tables_) {
+    size_t index;
+    if (Bitbase::calculateIndex(table.first, move.board, index)) {
+      return table.second[index];
+    }
+  }
+  throw Bitbase::InvalidMaterialException(material);
+}
+
+void BitbaseGenerator::runInParallel(size_t size, std::function<void(size_t, size_t)> job) const {
+  std::vector<std::thread> threads;
+  const size_t chunk = (size + number_of_threads_ - 1) / number_of_threads_;
+  for (size_t first = 0; first < size; first += chunk) {
+    threads.emplace_back(job, first, std::min(first + chunk, size));
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+}
+
+void BitbaseGenerator::calculateSuccessors(const std::string& material,
+                                           size_t first,
+                                           size_t last,
+                                           std::vector<std::vector<uint32_t>>& successors,
+                                           std::vector<int8_t>& values,
+                                           std::vector<uint8_t>& resolved) const {
+  Board board(kEmptyBoardFen);
+  for (size_t index = first; index < last; ++index) {
+    // Impossible positions are never reached from legal ones,
+    // they are stored as draws.
+    resolved[index] = true;
+    if (Bitbase::createBoard(material, index, board) == false) {
+      continue;
+    }
+    MoveCalculator calculator(board);
+    std::vector<Move> moves;
+    try {
+      moves = calculator.calculateAllMoves();
+    } catch (MoveCalculator::InvalidPositionException&) {
+      continue;
+    }
+    if (moves.empty()) {
+      values[index] = calculator.isCheck() ? -1 : 0;
+      continue;
+    }
+    resolved[index] = false;
+    for (const Move& move: moves) {
+      size_t successor;
+      if (move.insufficient_material) {
+        successors[index].push_back(kExternalFlag);
+      } else if (Bitbase::calculateIndex(material, move.board, successor)) {
+        successors[index].push_back(static_cast<uint32_t>(successor));
+      } else {
+        const uint8_t value = static_cast<uint8_t>(probeTables(move));
+        successors[index].push_back(kExternalFlag | value);
+      }
+    }
+  }
+}
+
+const std::vector<int8_t>& BitbaseGenerator::generate(const std::string& material) {
+  Bitbase::validateMaterial(material);
+  auto table = tables_.find(material);
+  if (table != tables_.end()) {
+    return table->second;
+  }
+  for (const std::string& dependency: getDependencies(material)) {
+    generate(dependency);
+  }
+
+  const size_t size = Bitbase::getNumberOfPositions(material);
+  std::vector<std::vector<uint32_t>> successors(size);
+  std::vector<int8_t> values(size, 0);
+  std::vector<uint8_t> resolved(size, false);
+  runInParallel(size, [&](size_t first, size_t last) {
+    calculateSuccessors(material, first, last, successors, values, resolved);
+  });
+
+  int max_external_value = 0;
+  for (const auto& position_successors: successors) {
+    for (const uint32_t successor: position_successors) {
+      if (successor & kExternalFlag) {
+        const int value = static_cast<int8_t>(successor & 0xFF);
+        max_external_value = std::max(max_external_value, std::abs(value));
+      }
+    }
+  }
+
+  // In pass n positions are resolved whose distance to mate is n, using
+  // only positions resolved in earlier passes.
+  for (int pass = 2; pass <= kMaxValue; ++pass) {
+    std::vector<int8_t> next_values = values;
+    std::vector<uint8_t> next_resolved = resolved;
+    std::atomic<bool> changed{false};
+    runInParallel(size, [&](size_t first, size_t last) {
+      for (size_t index = first; index < last; ++index) {
+        if (resolved[index]) {
+          continue;
+        }
+        bool can_win = false;
+        bool all_moves_lose = true;
+        int longest_loss = 0;
+        for (const uint32_t successor: successors[index]) {
+          int value;
+          if (successor & kExternalFlag) {
+            value = static_cast<int8_t>(successor & 0xFF);
+          } else if (resolved[successor]) {
+            value = values[successor];
+          } else {
+            all_moves_lose = false;
+            continue;
+          }
+          if (value == 1 - pass) {
+            can_win = true;
+            break;
+          }
+          if (value <= 0) {
+            all_moves_lose = false;
+          } else {
+            longest_loss = std::max(longest_loss, value);
+          }
+        }
+        if (can_win) {
+          next_values[index] = static_cast<int8_t>(pass);
+        } else if (all_moves_lose && longest_loss == pass - 1) {
+          next_values[index] = static_cast<int8_t>(-pass);
+        } else {
+          continue;
+        }
+        next_resolved[index] = true;
+        changed = true;
+      }
+    });
+    values.swap(next_values);
+    resolved.swap(next_resolved);
+    if (!changed && pass > max_external_value) {
+      break;
+    }
+  }
+  // Positions which were not resolved are draws.
+  return tables_[material] = std::move(values);
+}
@@ -0,0 +1,50 @@
+#ifndef BITBASE_GENERATOR_H
+#define BITBASE_GENERATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Bitbase.h"
+#include "MoveCalculator.h"
+
+// Builds Bitbase tables with retrograde analysis. Legal moves of every
+// position are calculated once with MoveCalculator, then positions are
+// resolved ply by ply: mates first, then positions with a move into
+// a position lost for the opponent in n plies, then positions with all
+// moves into positions won by the opponent, and so on. Work is spread
+// over a number of threads for each pass.
+class BitbaseGenerator {
+ public:
+  BitbaseGenerator(unsigned number_of_threads);
+
+  // Generates table for |material| and, first, tables for all material
+  // sets reachable from it by a capture or a promotion.
+  const std::vector<int8_t>& generate(const std::string& material);
+
+  const std::map<std::string, std::vector<int8_t>>& getTables() const {
+    return tables_;
+  }
+
+ private:
+  // Successor is either an index in the generated table or a value
+  // taken from an already generated one (marked with kExternalFlag).
+  static constexpr uint32_t kExternalFlag = 0x80000000u;
+
+  std::vector<std::string> getDependencies(const std::string& material) const;
+  int probeTables(const Move& move) const;
+  void calculateSuccessors(const std::string& material,
+                           size_t first,
+                           size_t last,
+                           std::vector<std::vector<uint32_t>>& successors,
+                           std::vector<int8_t>& values,
+                           std::vector<uint8_t>& resolved) const;
+  void runInParallel(size_t size, std::function<void(size_t, size_t)> job) const;
+
+  const unsigned number_of_threads_;
+  std::map<std::string, std::vector<int8_t>> tables_;
+};
+
+#endif  // BITBASE_GENERATOR_H
@@ -0,0 +1,85 @@
+/* Component tests for classes Bitbase and BitbaseGenerator */
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Bitbase.h"
+#include "BitbaseGenerator.h"
+#include "utils/Test.h"
+
+namespace {
+
+int probe(const std::vector<int8_t>& table, const std::string& material, const std::string& fen) {
+  size_t index;
+  bool found = Bitbase::calculateIndex(material, Board(fen), index);
+  assert(found);
+  return table[index];
+}
+
+TEST_PROCEDURE(Bitbase_material) {
+  TEST_START
+  VERIFY_EQUALS(Bitbase::getMaterial(Board("8/8/8/8/8/5K1k/5Q2/8 w - - 0 1")), "KQK");
+  VERIFY_EQUALS(Bitbase::getMaterial(Board("8/8/3k4/8/8/1q6/3K4/8 w - - 0 1")), "KKQ");
+  VERIFY_EQUALS(Bitbase::getNumberOfPositions("KRK"), 2lu * 64 * 64 * 64);
+  VERIFY_TRUE(Bitbase::isSufficientMaterial("KPK"));
+  VERIFY_FALSE(Bitbase::isSufficientMaterial("KNK"));
+  VERIFY_FALSE(Bitbase::isSufficientMaterial("KBKB"));
+  const std::vector<std::string> invalid_materials = {"", "QKK", "KQ", "KQKQ", "KKK", "KXK"};
+  for (const auto& material: invalid_materials) {
+    bool exception_was_thrown = false;
+    try {
+      Bitbase::validateMaterial(material);
+    } catch (Bitbase::InvalidMaterialException&) {
+      exception_was_thrown = true;
+    }
+    if (exception_was_thrown == false) {
+      NOT_REACHED(std::string("Exception InvalidMaterialException was not thrown for ") + material);
+    }
+  }
+  TEST_END
+}
+
+TEST_PROCEDURE(Bitbase_index_round_trip) {
+  TEST_START
+  const std::string fen = "8/8/8/8/8/5K1k/5Q2/8 b - - 0 1";
+  size_t index;
+  VERIFY_TRUE(Bitbase::calculateIndex("KQK", Board(fen), index));
+  Board board("8/8/8/8/8/8/8/8 w - - 0 1");
+  VERIFY_TRUE(Bitbase::createBoard("KQK", index, board));
+  VERIFY_EQUALS(board.createFEN(), fen);
+  // Colors swapped.
+  size_t mirrored_index;
+  VERIFY_TRUE(Bitbase::calculateIndex("KQK", Board("8/5q2/5k1K/8/8/8/8/8 w - - 0 1"), mirrored_index));
+  VERIFY_EQUALS(index, mirrored_index);
+  VERIFY_FALSE(Bitbase::calculateIndex("KRK", Board(fen), index));
+  TEST_END
+}
+
+TEST_PROCEDURE(BitbaseGenerator_KQK) {
+  TEST_START
+  BitbaseGenerator generator(4);
+  const std::vector<int8_t>& table = generator.generate("KQK");
+  // Mated, mate in one and a queen which can be captured.
+  VERIFY_EQUALS(probe(table, "KQK", "8/8/8/8/8/5KQk/8/8 b - - 1 1"), -1);
+  VERIFY_EQUALS(probe(table, "KQK", "8/8/8/8/8/5K1k/5Q2/8 w - - 0 1"), 2);
+  VERIFY_EQUALS(probe(table, "KQK", "8/8/8/8/8/8/1k6/1Q2K3 b - - 0 1"), 0);
+  // The longest KQK win is mate in 10, that is 19 plies.
+  VERIFY_EQUALS(*std::max_element(table.begin(), table.end()), 20);
+
+  const std::string path = "/tmp/bitbase_tests.bb";
+  Bitbase::write(path, "KQK", table);
+  Bitbase bitbase(path);
+  VERIFY_EQUALS(bitbase.getMaterial(), "KQK");
+  int value = 0;
+  VERIFY_TRUE(bitbase.probe(Board("8/8/8/8/8/5K1k/5Q2/8 w - - 0 1"), value));
+  VERIFY_EQUALS(value, 2);
+  VERIFY_TRUE(bitbase.probe(Board("8/5q2/5k1K/8/8/8/8/8 b - - 0 1"), value));
+  VERIFY_EQUALS(value, 2);
+  VERIFY_FALSE(bitbase.probe(Board("8/8/8/8/8/5K1k/5R2/8 w - - 0 1"), value));
+  std::remove(path.c_str());
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -1,5 +1,6 @@
 #include "Board.h"
 
+#include "BoardScan.h"
 #include "utils/Utils.h"
 
 Square Square::InvalidSquare = {static_cast<size_t>(-1),
@@ -165,10 +166,18 @@ std::string Board::createFEN() const {
 }
 
 void Board::writeFiguresToFEN(std::stringstream& fen) const {
+  uint64_t white, black;
+  board_scan::calculateColorMasks(*this, white, black);
+  const uint64_t occupied = white | black;
+  constexpr uint64_t kFirstRowMask = 0x0101010101010101ull;
   for (int row = kBoardSize - 1; row >= 0; --row) {
+    if ((occupied & (kFirstRowMask << row)) == 0ull) {
+      fen << kBoardSize << (row > 0 ? "/" : "");
+      continue;
+    }
     int empty_lines = 0;
     for (size_t line = 0; line < kBoardSize; ++line) {
-      if (squares_[line][row] == 0x0) {
+      if ((occupied & (1ull << (line * kBoardSize + row))) == 0ull) {
         ++empty_lines;
       } else {
         if (empty_lines > 0) {
@@ -218,13 +227,16 @@ void Board::writeMiscDataToFEN(std::stringstream& fen) const {
 }
 
 bool Board::operator==(const std::string& fen) const {
-  Board second(fen);
-  return squares_ == second.squares_ &&
-         en_passant_target_square_ == second.en_passant_target_square_ &&
-         halfmove_clock_ == second.halfmove_clock_ &&
-         fullmove_number_ == second.fullmove_number_ &&
-         castlings_ == second.castlings_ &&
-         white_to_move_ == second.white_to_move_;
+  return *this == Board(fen);
+}
+
+bool Board::operator==(const Board& other) const {
+  return squares_ == other.squares_ &&
+         en_passant_target_square_ == other.en_passant_target_square_ &&
+         halfmove_clock_ == other.halfmove_clock_ &&
+         fullmove_number_ == other.fullmove_number_ &&
+         castlings_ == other.castlings_ &&
+         white_to_move_ == other.white_to_move_;
 }
 
 char Board::getSquare(const std::string& square) const {
@@ -239,6 +251,18 @@ char Board::getSquare(const std::string& square) const {
   return squares_[line][row];
 }
 
+bool Board::isEnPassantCapturePossible() const {
+  if (en_passant_target_square_ == Square::InvalidSquare) {
+    return false;
+  }
+  const size_t line = en_passant_target_square_.letter - 'a';
+  const size_t row = en_passant_target_square_.number - '1';
+  const char pawn = white_to_move_ ? 'P' : 'p';
+  const size_t pawn_row = white_to_move_ ? row - 1 : row + 1;
+  return (line > 0 && squares_[line - 1][pawn_row] == pawn) ||
+         (line + 1 < kBoardSize && squares_[line + 1][pawn_row] == pawn);
+}
+
 void Board::resetCastlings(bool for_white) {
   if (for_white) {
     resetCastling(Castling::Q);
@@ -48,6 +48,11 @@ class Board {
 
   char getSquare(const std::string& square) const;
 
+  // All squares in one block, at(line, row) is at index line * kBoardSize + row.
+  const char* getSquares() const {
+    return squares_[0].data();
+  }
+
   bool canCastle(Castling castling) const;
   std::string createFEN() const;
 
@@ -63,6 +68,18 @@ class Board {
     ++fullmove_number_;
   }
 
+  unsigned getFullmoveNumber() const {
+    return fullmove_number_;
+  }
+
+  void setFullmoveNumber(unsigned fullmove_number) {
+    fullmove_number_ = fullmove_number;
+  }
+
+  unsigned getNumberOfHalfMoves() const {
+    return halfmove_clock_;
+  }
+
   void incrementNumberOfHalfMoves() {
     ++halfmove_clock_;
   }
@@ -71,7 +88,12 @@ class Board {
     halfmove_clock_ = 0;
   }
 
+  void setNumberOfHalfMoves(unsigned halfmove_clock) {
+    halfmove_clock_ = halfmove_clock;
+  }
+
   bool operator==(const std::string& fen) const;
+  bool operator==(const Board& other) const;
 
   Square getEnPassantTargetSquare() const {
     return en_passant_target_square_;
@@ -81,6 +103,14 @@ class Board {
     en_passant_target_square_ = square;
   }
 
+  // True if a pawn of the side to move stands next to the pawn
+  // which has just made a double step.
+  bool isEnPassantCapturePossible() const;
+
+  void setCastling(Castling castling) {
+    castlings_ |= 1 << static_cast<int>(castling);
+  }
+
   void resetCastling(Castling castling) {
     castlings_ &= ~(1 << static_cast<int>(castling));
   }
@@ -96,6 +126,7 @@ class Board {
   void writeMiscDataToFEN(std::stringstream& fen) const;
 
   std::array<std::array<char, kBoardSize>, kBoardSize> squares_;
+  static_assert(sizeof(squares_) == kBoardSize * kBoardSize, "Squares have to be contiguous");
   char castlings_ = 0x0;
   Square en_passant_target_square_{Square::InvalidSquare};
   bool white_to_move_{true};
@@ -0,0 +1,223 @@
+#include "BoardScan.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BOARD_SCAN_X86
+#endif
+
+namespace board_scan {
+
+namespace {
+
+constexpr size_t kSquares = Board::kBoardSize * Board::kBoardSize;
+// Figures are letters: white ones are upper case, black ones lower case.
+constexpr char kFirstBlackFigure = 'a';
+
+struct Kernels {
+  Implementation implementation;
+  void (*color_masks)(const char* squares, uint64_t& white, uint64_t& black);
+  void (*masks)(const char* squares, Masks& masks);
+};
+
+void calculateColorMasksScalar(const char* squares, uint64_t& white, uint64_t& black) {
+  white = 0ull;
+  black = 0ull;
+  for (size_t i = 0; i < kSquares; ++i) {
+    if (squares[i] >= kFirstBlackFigure) {
+      black |= 1ull << i;
+    } else if (squares[i] != 0x0) {
+      white |= 1ull << i;
+    }
+  }
+}
+
+void calculateMasksScalar(const char* squares, Masks& masks) {
+  calculateColorMasksScalar(squares, masks.white, masks.black);
+  for (size_t figure = 0; figure < kNumberOfFigures; ++figure) {
+    masks.figures[figure] = 0ull;
+    for (size_t i = 0; i < kSquares; ++i) {
+      if (squares[i] == kFigures[figure]) {
+        masks.figures[figure] |= 1ull << i;
+      }
+    }
+  }
+}
+
+#ifdef BOARD_SCAN_X86
+
+// Each kernel loads the 64 squares once and builds masks with byte compares.
+struct SSE2Board {
+  __m128i parts[4];
+};
+
+inline SSE2Board loadSSE2(const char* squares) {
+  SSE2Board board;
+  for (size_t i = 0; i < 4; ++i) {
+    board.parts[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(squares) + i);
+  }
+  return board;
+}
+
+inline uint64_t toMask(const __m128i compared[4]) {
+  uint64_t result = 0ull;
+  for (size_t i = 0; i < 4; ++i) {
+    result |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(compared[i]))) << (16 * i);
+  }
+  return result;
+}
+
+inline uint64_t figureMaskSSE2(const SSE2Board& board, char figure) {
+  const __m128i value = _mm_set1_epi8(figure);
+  __m128i compared[4];
+  for (size_t i = 0; i < 4; ++i) {
+    compared[i] = _mm_cmpeq_epi8(board.parts[i], value);
+  }
+  return toMask(compared);
+}
+
+inline void colorMasksSSE2(const SSE2Board& board, uint64_t& white, uint64_t& black) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i black_limit = _mm_set1_epi8(kFirstBlackFigure - 1);
+  __m128i white_compared[4];
+  __m128i black_compared[4];
+  for (size_t i = 0; i < 4; ++i) {
+    black_compared[i] = _mm_cmpgt_epi8(board.parts[i], black_limit);
+    white_compared[i] = _mm_andnot_si128(black_compared[i], _mm_cmpgt_epi8(board.parts[i], zero));
+  }
+  white = toMask(white_compared);
+  black = toMask(black_compared);
+}
+
+void calculateColorMasksSSE2(const char* squares, uint64_t& white, uint64_t& black) {
+  colorMasksSSE2(loadSSE2(squares), white, black);
+}
+
+void calculateMasksSSE2(const char* squares, Masks& masks) {
+  const SSE2Board board = loadSSE2(squares);
+  colorMasksSSE2(board, masks.white, masks.black);
+  for (size_t figure = 0; figure < kNumberOfFigures; ++figure) {
+    masks.figures[figure] = figureMaskSSE2(board, kFigures[figure]);
+  }
+}
+
+struct AVX2Board {
+  __m256i parts[2];
+};
+
+__attribute__((target("avx2")))
+inline AVX2Board loadAVX2(const char* squares) {
+  AVX2Board board;
+  board.parts[0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(squares));
+  board.parts[1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(squares) + 1);
+  return board;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t toMask(__m256i low, __m256i high) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(low))) |
+         static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high))) << 32;
+}
+
+__attribute__((target("avx2")))
+inline void colorMasksAVX2(const AVX2Board& board, uint64_t& white, uint64_t& black) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i black_limit = _mm256_set1_epi8(kFirstBlackFigure - 1);
+  const __m256i black_low = _mm256_cmpgt_epi8(board.parts[0], black_limit);
+  const __m256i black_high = _mm256_cmpgt_epi8(board.parts[1], black_limit);
+  white = toMask(_mm256_andnot_si256(black_low, _mm256_cmpgt_epi8(board.parts[0], zero)),
+                 _mm256_andnot_si256(black_high, _mm256_cmpgt_epi8(board.parts[1], zero)));
+  black = toMask(black_low, black_high);
+}
+
+__attribute__((target("avx2")))
+void calculateColorMasksAVX2(const char* squares, uint64_t& white, uint64_t& black) {
+  colorMasksAVX2(loadAVX2(squares), white, black);
+}
+
+__attribute__((target("avx2")))
+void calculateMasksAVX2(const char* squares, Masks& masks) {
+  const AVX2Board board = loadAVX2(squares);
+  colorMasksAVX2(board, masks.white, masks.black);
+  for (size_t figure = 0; figure < kNumberOfFigures; ++figure) {
+    const __m256i value = _mm256_set1_epi8(kFigures[figure]);
+    masks.figures[figure] = toMask(_mm256_cmpeq_epi8(board.parts[0], value),
+                                   _mm256_cmpeq_epi8(board.parts[1], value));
+  }
+}
+
+#endif  // BOARD_SCAN_X86
+
+constexpr Kernels kScalarKernels{Implementation::SCALAR, calculateColorMasksScalar, calculateMasksScalar};
+#ifdef BOARD_SCAN_X86
+constexpr Kernels kSSE2Kernels{Implementation::SSE2, calculateColorMasksSSE2, calculateMasksSSE2};
+constexpr Kernels kAVX2Kernels{Implementation::AVX2, calculateColorMasksAVX2, calculateMasksAVX2};
+#endif
+
+bool isSupported(Implementation implementation) {
+  switch (implementation) {
+    case Implementation::SCALAR:
+      return true;
+#ifdef BOARD_SCAN_X86
+    case Implementation::SSE2:
+      return __builtin_cpu_supports("sse2");
+    case Implementation::AVX2:
+      return __builtin_cpu_supports("avx2");
+#else
+    default:
+      return false;
+#endif
+  }
+  return false;
+}
+
+const Kernels* getKernels(Implementation implementation) {
+#ifdef BOARD_SCAN_X86
+  switch (implementation) {
+    case Implementation::AVX2:
+      return &kAVX2Kernels;
+    case Implementation::SSE2:
+      return &kSSE2Kernels;
+    case Implementation::SCALAR:
+      break;
+  }
+#endif
+  return &kScalarKernels;
+}
+
+const Kernels* selectKernels() {
+  for (Implementation implementation: {Implementation::AVX2, Implementation::SSE2}) {
+    if (isSupported(implementation)) {
+      return getKernels(implementation);
+    }
+  }
+  return &kScalarKernels;
+}
+
+// May be switched while other threads scan boards.
+std::atomic<const Kernels*> kernels{selectKernels()};
+
+}  // unnamed namespace
+
+void calculateColorMasks(const Board& board, uint64_t& white, uint64_t& black) {
+  kernels.load(std::memory_order_relaxed)->color_masks(board.getSquares(), white, black);
+}
+
+void calculateMasks(const Board& board, Masks& masks) {
+  kernels.load(std::memory_order_relaxed)->masks(board.getSquares(), masks);
+}
+
+Implementation getImplementation() {
+  return kernels.load(std::memory_order_relaxed)->implementation;
+}
+
+bool setImplementation(Implementation implementation) {
+  if (!isSupported(implementation)) {
+    return false;
+  }
+  kernels.store(getKernels(implementation), std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace board_scan
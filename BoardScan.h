@@ -0,0 +1,63 @@
+#ifndef BOARD_SCAN_H
+#define BOARD_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Board.h"
+
+// Whole-board scans done with SIMD compares. Bit (line * 8 + row) of every
+// mask stands for Board::at(line, row). Implementation is chosen at startup
+// from what the CPU supports; scalar code is used on other architectures.
+namespace board_scan {
+
+enum class Implementation {
+  SCALAR,
+  SSE2,
+  AVX2
+};
+
+constexpr size_t kNumberOfFigures = 12;
+// Order of figures in Masks::figures.
+constexpr char kFigures[kNumberOfFigures + 1] = "PNBRQKpnbrqk";
+
+struct Masks {
+  uint64_t white;
+  uint64_t black;
+  uint64_t figures[kNumberOfFigures];
+};
+
+constexpr size_t getFigureIndex(char figure) {
+  size_t index = 0;
+  while (index < kNumberOfFigures && kFigures[index] != figure) {
+    ++index;
+  }
+  return index;
+}
+
+inline uint64_t getFigureMask(const Masks& masks, char figure) {
+  return masks.figures[getFigureIndex(figure)];
+}
+
+void calculateColorMasks(const Board& board, uint64_t& white, uint64_t& black);
+void calculateMasks(const Board& board, Masks& masks);
+
+inline unsigned count(uint64_t mask) {
+  return __builtin_popcountll(mask);
+}
+
+inline size_t getLine(unsigned index) {
+  return index / Board::kBoardSize;
+}
+
+inline size_t getRow(unsigned index) {
+  return index % Board::kBoardSize;
+}
+
+Implementation getImplementation();
+// Returns false if |implementation| is not supported by the CPU.
+bool setImplementation(Implementation implementation);
+
+}  // namespace board_scan
+
+#endif  // BOARD_SCAN_H
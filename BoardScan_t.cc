@@ -0,0 +1,64 @@
+/* Component tests for namespace board_scan */
+
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "BoardScan.h"
+#include "utils/Test.h"
+
+namespace {
+
+const std::vector<std::string> kFens = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+  "8/8/8/8/8/8/8/k6K w - - 0 1"
+};
+
+TEST_PROCEDURE(BoardScan_masks) {
+  TEST_START
+  const Board board("8/8/8/8/8/8/1p6/K6k w - - 0 1");
+  board_scan::Masks masks;
+  board_scan::calculateMasks(board, masks);
+  // Bit (line * 8 + row): a1 is bit 0, b2 is bit 9, h1 is bit 56.
+  VERIFY_EQUALS(masks.white, 1ull);
+  VERIFY_EQUALS(masks.black, (1ull << 9) | (1ull << 56));
+  VERIFY_EQUALS(board_scan::getFigureMask(masks, 'K'), 1ull);
+  VERIFY_EQUALS(board_scan::getFigureMask(masks, 'p'), 1ull << 9);
+  VERIFY_EQUALS(board_scan::getFigureMask(masks, 'k'), 1ull << 56);
+  VERIFY_EQUALS(board_scan::getFigureMask(masks, 'Q'), 0ull);
+  TEST_END
+}
+
+TEST_PROCEDURE(BoardScan_implementations_agree) {
+  TEST_START
+  const board_scan::Implementation selected = board_scan::getImplementation();
+  VERIFY_TRUE(board_scan::setImplementation(board_scan::Implementation::SCALAR));
+  std::vector<board_scan::Masks> expected(kFens.size());
+  for (size_t i = 0; i < kFens.size(); ++i) {
+    board_scan::calculateMasks(Board(kFens[i]), expected[i]);
+  }
+  for (auto implementation: {board_scan::Implementation::SSE2, board_scan::Implementation::AVX2}) {
+    if (!board_scan::setImplementation(implementation)) {
+      continue;
+    }
+    for (size_t i = 0; i < kFens.size(); ++i) {
+      board_scan::Masks masks;
+      board_scan::calculateMasks(Board(kFens[i]), masks);
+      VERIFY_EQUALS(masks.white, expected[i].white);
+      VERIFY_EQUALS(masks.black, expected[i].black);
+      for (size_t figure = 0; figure < board_scan::kNumberOfFigures; ++figure) {
+        VERIFY_EQUALS(masks.figures[figure], expected[i].figures[figure]);
+      }
+      uint64_t white, black;
+      board_scan::calculateColorMasks(Board(kFens[i]), white, black);
+      VERIFY_EQUALS(white, expected[i].white);
+      VERIFY_EQUALS(black, expected[i].black);
+    }
+  }
+  board_scan::setImplementation(selected);
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "GameDatabase.h"
+#include "Zobrist.h"
+
+namespace {
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [--threads N] <input.pgn> <output.gdb>" << std::endl
+            << "       " << program << " --lookup <database.gdb> <fen>" << std::endl;
+}
+
+int build(const std::string& input_path, const std::string& output_path, unsigned threads) {
+  const auto start = std::chrono::steady_clock::now();
+  GameDatabaseBuilder builder(output_path);
+  const size_t games = builder.importPgn(input_path, threads);
+  builder.finish();
+  const auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  std::cerr << "Imported " << games << " games in " << time_ms << " ms" << std::endl;
+  return 0;
+}
+
+int lookup(const std::string& path, const std::string& fen) {
+  const GameDatabase database(path);
+  const Board board(fen);
+  const std::vector<uint32_t> results = database.getResults(zobrist::hash(board));
+  std::cout << "Games: +" << results[0] << " =" << results[1] << " -" << results[2]
+            << " *" << results[3] << std::endl;
+  for (const auto& statistics: database.getMoveStatistics(board)) {
+    std::cout << statistics.move << ": +" << statistics.results[0] << " ="
+              << statistics.results[1] << " -" << statistics.results[2]
+              << " *" << statistics.results[3] << std::endl;
+  }
+  const auto games = database.findGames(zobrist::hash(board));
+  std::cout << "Offsets:";
+  for (auto it = games.begin(); it != games.end() && it != games.begin() + 10; ++it) {
+    std::cout << " " << it->getOffset();
+  }
+  std::cout << (games.size() > 10 ? " ..." : "") << std::endl;
+  return 0;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  try {
+    if (argc == 4 && std::string(argv[1]) == "--lookup") {
+      return lookup(argv[2], argv[3]);
+    }
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (argc == 5 && std::string(argv[1]) == "--threads") {
+      std::istringstream value(argv[2]);
+      if (!(value >> threads) || threads == 0) {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (argc != 3) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    return build(argv[argc - 2], argv[argc - 1], threads);
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+  } catch (GameDatabase::InvalidFileException& e) {
+    std::cerr << "Invalid game database " << e.path << std::endl;
+  } catch (GameDatabaseBuilder::WriteFailedException& e) {
+    std::cerr << "Cannot write " << e.path << std::endl;
+  } catch (Board::InvalidFENException&) {
+    std::cerr << "Invalid FEN" << std::endl;
+  }
+  return 1;
+}
@@ -1,26 +1,42 @@
 #include "Engine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
-#include <ctime>
+#include <new>
+#include <type_traits>
 
 #include <iostream>
 
-#include "utils/Timer.h"
+#include "BoardScan.h"
+#include "Instrumentation.h"
+#include "Zobrist.h"
 
 namespace {
 
-constexpr int kQueenValue = 9;
-constexpr int kRookValue = 5;
-constexpr int kBishopValue = 3;
-constexpr int kKnightValue = 3;
-constexpr int kPawnValue = 1;
+// Values in centipawns.
+constexpr int kQueenValue = 900;
+constexpr int kRookValue = 500;
+constexpr int kBishopValue = 300;
+constexpr int kKnightValue = 300;
+constexpr int kPawnValue = 100;
 
-// Generates random value out of [0, max)
-unsigned generateRandomValue(int max) {
-  return rand() % max;
-}
+// Pawn structure terms in centipawns.
+constexpr int kDoubledPawnPenalty = 15;
+constexpr int kIsolatedPawnPenalty = 10;
+// By row counted from the pawn's side of the board.
+constexpr int kPassedPawnBonus[Board::kBoardSize] = {0, 5, 10, 20, 35, 60, 100, 0};
+
+constexpr size_t kMateSolverTableSizeMb = 64;
+
+// Search scores: mates rank beyond any evaluation, the shorter the better.
+constexpr int kMateScore = 100000;
+constexpr int kInfiniteScore = 1000000;
+// Node evaluations stay within static evaluation range.
+constexpr int kMaxEvaluation = 10000;
+// Half width of the first aspiration window, doubled after each fail.
+constexpr int kAspirationWindow = 25;
 
 int getFigureValue(char figure) {
   switch(figure) {
@@ -54,28 +70,206 @@ int getFigureValue(char figure) {
   return 0;
 }
 
+int evaluateMaterial(const board_scan::Masks& masks) {
+  int result = 0;
+  for (size_t figure = 0; figure < board_scan::kNumberOfFigures; ++figure) {
+    result += board_scan::count(masks.figures[figure]) * getFigureValue(board_scan::kFigures[figure]);
+  }
+  return result;
+}
+
+// Pawns of one line as bits of rows.
+uint64_t getPawnsOnLine(uint64_t pawns, size_t line) {
+  return line < Board::kBoardSize ? (pawns >> (line * Board::kBoardSize)) & 0xFFull : 0ull;
+}
+
+int evaluatePawnsOfSide(uint64_t pawns, uint64_t enemy_pawns, bool white) {
+  int result = 0;
+  for (size_t line = 0; line < Board::kBoardSize; ++line) {
+    const uint64_t line_pawns = getPawnsOnLine(pawns, line);
+    if (line_pawns == 0ull) {
+      continue;
+    }
+    const int count = board_scan::count(line_pawns);
+    result -= (count - 1) * kDoubledPawnPenalty;
+    // getPawnsOnLine(pawns, -1) gives no pawns.
+    if ((getPawnsOnLine(pawns, line - 1) | getPawnsOnLine(pawns, line + 1)) == 0ull) {
+      result -= count * kIsolatedPawnPenalty;
+    }
+    const uint64_t blockers = getPawnsOnLine(enemy_pawns, line - 1) |
+                              getPawnsOnLine(enemy_pawns, line) |
+                              getPawnsOnLine(enemy_pawns, line + 1);
+    for (uint64_t rows = line_pawns; rows; rows &= rows - 1) {
+      const unsigned row = __builtin_ctzll(rows);
+      const uint64_t rows_ahead = white ? (0xFFull << (row + 1)) & 0xFFull : (1ull << row) - 1;
+      if ((blockers & rows_ahead) == 0ull) {
+        result += kPassedPawnBonus[white ? row : Board::kBoardSize - 1 - row];
+      }
+    }
+  }
+  return result;
+}
+
+// From white's point of view.
+int evaluatePawnStructure(uint64_t white_pawns, uint64_t black_pawns) {
+  return evaluatePawnsOfSide(white_pawns, black_pawns, true) -
+         evaluatePawnsOfSide(black_pawns, white_pawns, false);
+}
+
+// Open and mate bounds do not fit into trace records.
+int16_t toTraceBound(int bound) {
+  return bound > -32767 && bound < 32767 ? static_cast<int16_t>(bound) : SearchTrace::kNoBound;
+}
+
 }  // unnamed namespace
 
 
 struct EngineMove {
+  template <typename T>
+  struct Range {
+    T* begin() const { return first; }
+    T* end() const { return first + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t index) const { return first[index]; }
+
+    T* first;
+    size_t size_;
+  };
+
+  // Result is known, move is not searched further (besides a found mate).
+  enum class Terminal : uint8_t {
+    NONE,
+    BITBASE,
+    DRAW
+  };
+
+  // How the evaluation of the last search relates to the true score.
+  enum class Bound : uint8_t {
+    EXACT,
+    // Score is at least the evaluation.
+    LOWER,
+    // Score is at most the evaluation.
+    UPPER
+  };
+
   EngineMove(const Move& m, float eval)
     : move_(m), evaluation_(eval) {}
 
+  Range<EngineMove> children() { return {children_, number_of_children_}; }
+  Range<const EngineMove> children() const { return {children_, number_of_children_}; }
+
+  // White-relative score of the move, with a found mate.
+  int getScore() const {
+    if (moves_to_mate_ > 0) {
+      return kMateScore - moves_to_mate_;
+    } else if (moves_to_mate_ < 0) {
+      return -kMateScore - moves_to_mate_;
+    }
+    return evaluation_;
+  }
+
   Move move_;
-  std::vector<EngineMove> children_;
+  // Contiguous block in the search tree arena.
+  EngineMove* children_{nullptr};
+  uint32_t number_of_children_{0};
   int evaluation_{0};
   int moves_to_mate_{0};
+  // Zobrist hash, calculated when the move is created.
+  uint64_t hash_{0};
+  Terminal terminal_{Terminal::NONE};
+  Bound bound_{Bound::EXACT};
 };
 
+static_assert(std::is_trivially_destructible<EngineMove>::value,
+              "Search tree is released by resetting its arena");
+
 Engine::Engine(unsigned depth, unsigned time_for_move_ms)
- : depth_(depth), time_for_move_ms_(time_for_move_ms) {
-  srand(static_cast<unsigned int>(clock()));
+ : depth_(depth), time_for_move_ms_(time_for_move_ms),
+   evaluation_cache_(std::make_shared<EvaluationCache>()) {
+  random_generator_.seed(std::random_device()());
 }
 
+Engine::~Engine() = default;
+
 void Engine::setStatsCallback(std::function<void(MoveStats)> callback) {
   stats_callback_ = callback;
 }
 
+void Engine::setIterationCallback(std::function<void(IterationStats)> callback) {
+  iteration_callback_ = callback;
+}
+
+void Engine::setRandomSeed(unsigned seed) {
+  random_generator_.seed(seed);
+}
+
+void Engine::setDepth(unsigned depth) {
+  depth_ = depth;
+}
+
+void Engine::setTimeForMove(unsigned time_for_move_ms) {
+  time_for_move_ms_ = time_for_move_ms;
+}
+
+void Engine::setNodesLimit(unsigned long long nodes) {
+  nodes_limit_ = nodes;
+}
+
+void Engine::setMultiPV(unsigned lines) {
+  multi_pv_ = std::max(lines, 1u);
+}
+
+void Engine::stop() {
+  time_out_ = true;
+}
+
+Engine::MateSolution Engine::solveMate(const Board& board, unsigned max_moves) {
+  if (!mate_solver_) {
+    mate_solver_ = std::make_unique<MateSolver>(kMateSolverTableSizeMb);
+  }
+  return mate_solver_->solve(board, max_moves, time_for_move_ms_);
+}
+
+void Engine::setOpeningBook(std::shared_ptr<const OpeningBook> book) {
+  opening_book_ = book;
+}
+
+void Engine::setSearchTrace(std::shared_ptr<SearchTrace> trace) {
+  search_trace_ = trace;
+}
+
+void Engine::setNetwork(std::shared_ptr<const Nnue> network) {
+  network_ = network;
+  // Cached scores come from the previous evaluation.
+  evaluation_cache_->clear();
+}
+
+void Engine::setEvaluationCache(std::shared_ptr<EvaluationCache> cache) {
+  evaluation_cache_ = cache;
+}
+
+void Engine::addBitbase(std::shared_ptr<const Bitbase> bitbase) {
+  bitbases_.push_back(bitbase);
+}
+
+bool Engine::probeBitbases(EngineMove& move) const {
+  for (const auto& bitbase: bitbases_) {
+    int value;
+    ++table_probes_;
+    if (bitbase->probe(move.move_.board, value)) {
+      ++table_hits_;
+      move.moves_to_mate_ = move.move_.board.whiteToMove() ? value : -value;
+      if (value == 0) {
+        move.evaluation_ = 0;
+      }
+      move.terminal_ = EngineMove::Terminal::BITBASE;
+      return true;
+    }
+  }
+  return false;
+}
+
 void Engine::findBorderValuesInChildren(
     const EngineMove& move,
     int& the_biggest_value,
@@ -88,7 +282,7 @@ void Engine::findBorderValuesInChildren(
   the_biggest_negative_value = -10000;
   the_lowest_positive_value = 10000;
   is_move_without_mate = false;
-  for (const auto& child: move.children_) {
+  for (const auto& child: move.children()) {
     const int mate_in = child.moves_to_mate_;
     if (mate_in == 0) {
       is_move_without_mate = true;
@@ -147,102 +341,544 @@ void Engine::updateMovesToMate(EngineMove& move) const {
   }
 }
 
-void Engine::evaluateMove(EngineMove& engine_move) const {
-  if (engine_move.moves_to_mate_ != 0) {
+void Engine::evaluateMove(EngineMove& engine_move, unsigned depth, int alpha, int beta) const {
+  if (engine_move.moves_to_mate_ != 0 || engine_move.terminal_ != EngineMove::Terminal::NONE) {
+    if (active_trace_) {
+      traceNode(engine_move, SearchTrace::Event::TERMINAL, getCutoffReason(engine_move),
+                alpha, beta);
+    }
     return;
   }
-  if (engine_move.children_.empty()) {
-    MoveCalculator calculator(engine_move.move_.board);
+  const bool expansion = engine_move.children().empty();
+  if (expansion) {
+    INSTRUMENT_COUNT(EXPANDED_NODES);
+    INSTRUMENT_SCOPE(NODE_EXPANSION);
+    const Board& board = engine_move.move_.board;
+    if (current_ply_ > 0 && isRepetition(engine_move)) {
+      markAsDraw(engine_move, alpha, beta);
+      return;
+    }
+    MoveCalculator calculator(board);
     auto moves = calculator.calculateAllMoves();
     if (moves.empty()) {
       if (calculator.isCheck()) {
-        engine_move.moves_to_mate_ = engine_move.move_.board.whiteToMove() ? -1 : 1;
+        engine_move.moves_to_mate_ = board.whiteToMove() ? -1 : 1;
       } else {
         // stalemate
         engine_move.evaluation_ = 0;
       }
+    } else if (current_ply_ > 0 && PositionHistory::isFiftyMoveRule(board)) {
+      // Checkmate takes precedence over the fifty-move rule.
+      markAsDraw(engine_move, alpha, beta);
+      return;
     }
-    engine_move.children_.reserve(moves.size());
-    for (Move& move: moves) {
-      float eval = calculateMoveEvaluation(move);
-      EngineMove new_move(move, eval);
-      engine_move.children_.push_back(new_move);
+    engine_move.children_ = arenas_[current_arena_].allocate<EngineMove>(moves.size());
+    engine_move.number_of_children_ = static_cast<uint32_t>(moves.size());
+    for (size_t i = 0; i < moves.size(); ++i) {
+      const uint64_t hash = zobrist::update(engine_move.hash_, board, moves[i].board);
+      float eval = calculateMoveEvaluation(board, moves[i], hash);
+      EngineMove* new_move = new (&engine_move.children_[i]) EngineMove(moves[i], eval);
+      new_move->hash_ = hash;
+      if (!bitbases_.empty()) {
+        probeBitbases(*new_move);
+      }
     }
-  } else if (!time_out_) {
-    for (EngineMove& child: engine_move.children_) {
-      evaluateMove(child);
+    // Expansions are rare enough to check the clock every time.
+    if ((nodes_limit_ > 0ull && nodes_calculated_ >= nodes_limit_) ||
+        std::chrono::steady_clock::now() >= deadline_) {
+      time_out_ = true;
     }
+    selective_depth_ = std::max(selective_depth_, current_ply_ + 1);
   }
-  if (!engine_move.children_.empty()) {
+  SearchTrace::Cutoff cutoff = SearchTrace::Cutoff::NONE;
+  if (!engine_move.children().empty()) {
+    // Children of a leaf keep their static evaluations.
+    if (depth > 1 && !time_out_) {
+      searchChildren(engine_move, depth - 1, alpha, beta);
+    } else {
+      updateBestEvaluation(engine_move);
+      engine_move.bound_ = EngineMove::Bound::EXACT;
+    }
     updateMovesToMate(engine_move);
+    if (engine_move.bound_ != EngineMove::Bound::EXACT) {
+      cutoff = SearchTrace::Cutoff::BETA;
+    }
+  }
+  if (time_out_) {
+    cutoff = getCutoffReason();
+  }
+  if (active_trace_) {
+    traceNode(engine_move,
+              expansion ? SearchTrace::Event::EXPANSION : SearchTrace::Event::VISIT,
+              cutoff, alpha, beta);
+  }
+}
+
+// Principal variation search: the child which was best in the previous
+// search gets the full window, the others only have to be proved worse with
+// a null window and are searched again when they are not.
+void Engine::searchChildren(EngineMove& engine_move, unsigned depth, int alpha, int beta) const {
+  const bool white_to_move = engine_move.move_.board.whiteToMove();
+  // Scores relative to the side to move.
+  const int sign = white_to_move ? 1 : -1;
+  const int original_alpha = white_to_move ? alpha : -beta;
+  const int original_beta = white_to_move ? beta : -alpha;
+  auto search = [&](EngineMove& child, int lower, int upper) {
+    if (white_to_move) {
+      evaluateMove(child, depth, lower, upper);
+    } else {
+      evaluateMove(child, depth, -upper, -lower);
+    }
+    return sign * child.getScore();
+  };
+
+  const bool root = current_ply_ == 0;
+  // Root is already the last position of the history.
+  if (!root) {
+    search_history_.push(engine_move.hash_);
+  }
+  ++current_ply_;
+  if (network_ && accumulators_.size() <= current_ply_) {
+    accumulators_.resize(current_ply_ + 1);
+  }
+  if (search_orders_.size() < current_ply_) {
+    search_orders_.resize(current_ply_);
+  }
+  std::vector<EngineMove*>& order = search_orders_[current_ply_ - 1];
+  order.clear();
+  for (EngineMove& child: engine_move.children()) {
+    order.push_back(&child);
+  }
+  // The first of equally good root moves is played, so their order is random.
+  if (root) {
+    std::shuffle(order.begin(), order.end(), random_generator_);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [sign](const EngineMove* first, const EngineMove* second) {
+                     return sign * first->getScore() > sign * second->getScore();
+                   });
+
+  // Exact scores of root moves, ascending.
+  std::vector<int> root_scores;
+  int alpha_value = original_alpha;
+  int best = -kInfiniteScore;
+  size_t searched = 0;
+  for (EngineMove* child: order) {
+    if (time_out_) {
+      break;
+    }
+    if (network_ && child->moves_to_mate_ == 0 && child->terminal_ == EngineMove::Terminal::NONE) {
+      network_->update(accumulators_[current_ply_ - 1], engine_move.move_.board,
+                       child->move_.board, accumulators_[current_ply_]);
+    }
+    int value;
+    if (root) {
+      // Root moves are only proved worse than the |multi_pv_|-th best one,
+      // so all reported lines get exact scores.
+      int lower = original_alpha;
+      bool better = true;
+      if (root_scores.size() >= multi_pv_) {
+        lower = root_scores[root_scores.size() - multi_pv_];
+        value = search(*child, lower, lower + 1);
+        better = value > lower;
+      }
+      if (better) {
+        value = search(*child, lower, original_beta);
+        if (value > lower && value < original_beta) {
+          root_scores.insert(std::upper_bound(root_scores.begin(), root_scores.end(), value), value);
+        }
+      }
+    } else if (searched == 0) {
+      value = search(*child, alpha_value, original_beta);
+    } else {
+      value = search(*child, alpha_value, alpha_value + 1);
+      if (value > alpha_value && value < original_beta) {
+        value = search(*child, alpha_value, original_beta);
+      }
+    }
+    ++searched;
+    best = std::max(best, value);
+    alpha_value = std::max(alpha_value, value);
+    if (alpha_value >= original_beta) {
+      break;
+    }
+  }
+  --current_ply_;
+  if (!root) {
+    search_history_.pop();
+  }
+
+  if (searched == 0) {
     updateBestEvaluation(engine_move);
+    engine_move.bound_ = EngineMove::Bound::EXACT;
+    return;
+  }
+  engine_move.evaluation_ = std::max(std::min(sign * best, kMaxEvaluation), -kMaxEvaluation);
+  if (best <= original_alpha) {
+    engine_move.bound_ = white_to_move ? EngineMove::Bound::UPPER : EngineMove::Bound::LOWER;
+  } else if (best >= original_beta) {
+    engine_move.bound_ = white_to_move ? EngineMove::Bound::LOWER : EngineMove::Bound::UPPER;
+  } else {
+    engine_move.bound_ = EngineMove::Bound::EXACT;
+  }
+}
+
+// A position repeated within the search is scored as a draw right away,
+// positions from the game before the root only when repeated twice.
+bool Engine::isRepetition(const EngineMove& move) const {
+  const PositionHistory::Repetitions repetitions = search_history_.countRepetitions(
+      move.hash_, move.move_.board.getNumberOfHalfMoves(), root_history_index_);
+  return repetitions.since_index > 0 || repetitions.total >= 2;
+}
+
+void Engine::markAsDraw(EngineMove& move, int alpha, int beta) const {
+  move.evaluation_ = 0;
+  move.terminal_ = EngineMove::Terminal::DRAW;
+  if (active_trace_) {
+    traceNode(move, SearchTrace::Event::TERMINAL, SearchTrace::Cutoff::DRAW, alpha, beta);
   }
 }
 
+SearchTrace::Cutoff Engine::getCutoffReason(const EngineMove& move) const {
+  if (move.moves_to_mate_ != 0) {
+    return SearchTrace::Cutoff::MATE;
+  }
+  return move.terminal_ == EngineMove::Terminal::DRAW ?
+      SearchTrace::Cutoff::DRAW : SearchTrace::Cutoff::BITBASE;
+}
+
+SearchTrace::Cutoff Engine::getCutoffReason() const {
+  return nodes_limit_ > 0ull && nodes_calculated_ >= nodes_limit_ ?
+      SearchTrace::Cutoff::NODES : SearchTrace::Cutoff::TIME;
+}
+
+void Engine::traceNode(const EngineMove& move, SearchTrace::Event event,
+                       SearchTrace::Cutoff cutoff, int alpha, int beta) const {
+  SearchTrace::Record record{};
+  record.event = event;
+  record.ply = static_cast<uint8_t>(std::min(current_ply_, 255u));
+  record.move = current_ply_ > 0 ? OpeningBook::encodeMove(move.move_) : 0;
+  record.children = static_cast<uint16_t>(move.children().size());
+  record.cutoff = cutoff;
+  record.score = static_cast<int16_t>(std::max(std::min(move.evaluation_, 32767), -32767));
+  record.moves_to_mate = static_cast<int16_t>(move.moves_to_mate_);
+  record.alpha = toTraceBound(alpha);
+  record.beta = toTraceBound(beta);
+  active_trace_->add(record);
+}
+
 
 void Engine::updateBestEvaluation(EngineMove& move) const {
   bool white_to_move = move.move_.board.whiteToMove();
-  float best_move_value = white_to_move ? -10000.0 : 10000.0;
-  for (auto& child: move.children_) {
-    float move_value = child.evaluation_;
+  int best_move_value = white_to_move ? -kInfiniteScore : kInfiniteScore;
+  for (auto& child: move.children()) {
+    int move_value = child.getScore();
     if ((white_to_move && move_value > best_move_value) ||
         (!white_to_move && move_value < best_move_value)) {
       best_move_value = move_value;
     }
   }
-  move.evaluation_ = best_move_value;
+  move.evaluation_ = std::max(std::min(best_move_value, kMaxEvaluation), -kMaxEvaluation);
 }
 
-float Engine::calculateMoveEvaluation(const Move& move) const {
+float Engine::calculateMoveEvaluation(const Board& parent_board, const Move& move,
+                                      uint64_t hash) const {
+  INSTRUMENT_COUNT(EVALUATED_MOVES);
   ++nodes_calculated_;
-  float result = 0.0;
-  for (size_t line = 0; line < Board::kBoardSize; ++line) {
-    for (size_t row = 0; row < Board::kBoardSize; ++row) {
-      char figure = move.board.at(line, row);
-      if (figure == 0x0) {
-        continue;
-      }
-      result += getFigureValue(figure);
-    }
+  int score;
+  if (evaluation_cache_->probe(hash, score)) {
+    ++evaluation_cache_stats_.hits;
+    return score;
   }
-  return result;
+  ++evaluation_cache_stats_.misses;
+  if (network_) {
+    Nnue::Accumulator accumulator;
+    network_->update(accumulators_[current_ply_], parent_board, move.board, accumulator);
+    score = network_->evaluate(accumulator, move.board.whiteToMove());
+    score = move.board.whiteToMove() ? score : -score;
+  } else {
+    score = evaluatePosition(move.board);
+  }
+  evaluation_cache_->store(hash, score);
+  return score;
+}
+
+int Engine::evaluatePosition(const Board& board) const {
+  board_scan::Masks masks;
+  board_scan::calculateMasks(board, masks);
+  const uint64_t white_pawns = board_scan::getFigureMask(masks, 'P');
+  const uint64_t black_pawns = board_scan::getFigureMask(masks, 'p');
+  int pawn_structure;
+  if (pawn_table_.probe(white_pawns, black_pawns, pawn_structure)) {
+    ++pawn_table_stats_.hits;
+  } else {
+    ++pawn_table_stats_.misses;
+    pawn_structure = evaluatePawnStructure(white_pawns, black_pawns);
+    pawn_table_.store(white_pawns, black_pawns, pawn_structure);
+  }
+  return evaluateMaterial(masks) + pawn_structure;
+}
+
+int Engine::evaluate(const Board& board) {
+  board_scan::Masks masks;
+  board_scan::calculateMasks(board, masks);
+  return evaluateMaterial(masks) + evaluatePawnStructure(board_scan::getFigureMask(masks, 'P'),
+                                                         board_scan::getFigureMask(masks, 'p'));
 }
 
 Move Engine::findBestMove(const EngineMove& parent) const {
   float best_evaluation = parent.evaluation_;
   std::vector<Move> best_moves;
   int shift = parent.move_.board.whiteToMove() ? 1 : -1;
-  for (const EngineMove& child: parent.children_) {
+  for (const EngineMove& child: parent.children()) {
     if (parent.moves_to_mate_ != 0) {
       if (child.moves_to_mate_ + shift == parent.moves_to_mate_) {
         best_moves.push_back(child.move_);
       }
-    } else if (child.evaluation_ == best_evaluation) {
+    } else if (child.bound_ == EngineMove::Bound::EXACT && child.getScore() == best_evaluation) {
       best_moves.push_back(child.move_);
     }
   }
-  size_t index = generateRandomValue(best_moves.size());
+  if (best_moves.empty()) {
+    // Interrupted search left no exact score, the best bound is taken.
+    const EngineMove* best = &parent.children()[0];
+    for (const EngineMove& child: parent.children()) {
+      if (shift * child.getScore() > shift * best->getScore()) {
+        best = &child;
+      }
+    }
+    best_moves.push_back(best->move_);
+  }
+  std::uniform_int_distribution<size_t> distribution(0, best_moves.size() - 1);
+  size_t index = distribution(random_generator_);
   return best_moves[index];
 }
 
-void Engine::timerCallback() {
-  time_out_ = true;
+void Engine::collectPrincipalVariation(const EngineMove& move,
+                                       std::vector<Move>& variation) const {
+  const int shift = move.move_.board.whiteToMove() ? 1 : -1;
+  for (const EngineMove& child: move.children()) {
+    const bool is_best = move.moves_to_mate_ != 0 ?
+        child.moves_to_mate_ + shift == move.moves_to_mate_ :
+        child.bound_ == EngineMove::Bound::EXACT && child.getScore() == move.evaluation_;
+    if (is_best) {
+      variation.push_back(child.move_);
+      collectPrincipalVariation(child, variation);
+      return;
+    }
+  }
+}
+
+// Root search keeps scores of the |multi_pv_| best root moves exact,
+// so all lines come from the same search.
+std::vector<Engine::Line> Engine::collectLines(const EngineMove& root) const {
+  const int shift = root.move_.board.whiteToMove() ? 1 : -1;
+  std::vector<const EngineMove*> children;
+  for (const EngineMove& child: root.children()) {
+    children.push_back(&child);
+  }
+  const size_t number_of_lines = std::min<size_t>(multi_pv_, children.size());
+  // Exact scores go before equal bounds.
+  std::stable_sort(children.begin(), children.end(),
+                   [shift](const EngineMove* first, const EngineMove* second) {
+                     const int first_value = shift * first->getScore();
+                     const int second_value = shift * second->getScore();
+                     return first_value > second_value ||
+                            (first_value == second_value &&
+                             first->bound_ == EngineMove::Bound::EXACT &&
+                             second->bound_ != EngineMove::Bound::EXACT);
+                   });
+  std::vector<Line> lines;
+  for (size_t i = 0; i < number_of_lines; ++i) {
+    const EngineMove& child = *children[i];
+    std::vector<Move> principal_variation{child.move_};
+    collectPrincipalVariation(child, principal_variation);
+    lines.push_back(Line{child.evaluation_,
+                         child.moves_to_mate_ != 0 ? child.moves_to_mate_ + shift : 0,
+                         principal_variation});
+  }
+  return lines;
+}
+
+void Engine::prepareRoot(const Board& board) {
+  if (root_) {
+    if (root_->move_.board == board) {
+      return;
+    }
+    // Look for |board| among positions reached after one and two plies.
+    for (EngineMove& child: root_->children()) {
+      if (child.move_.board == board) {
+        moveToFreshArena(child);
+        root_depth_ = root_depth_ > 0 ? root_depth_ - 1 : 0;
+        return;
+      }
+    }
+    for (EngineMove& child: root_->children()) {
+      for (EngineMove& grandchild: child.children()) {
+        if (grandchild.move_.board == board) {
+          moveToFreshArena(grandchild);
+          root_depth_ = root_depth_ > 1 ? root_depth_ - 2 : 0;
+          return;
+        }
+      }
+    }
+  }
+  arenas_[current_arena_].reset();
+  Move move(board, 0, 0, 0, 0);
+  root_ = new (arenas_[current_arena_].allocate<EngineMove>(1)) EngineMove(move, 0.0);
+  root_->hash_ = zobrist::hash(board);
+  root_depth_ = 0;
+}
+
+void Engine::moveToFreshArena(const EngineMove& new_root) {
+  const size_t old_arena = current_arena_;
+  current_arena_ = 1 - current_arena_;
+  arenas_[current_arena_].reset();
+  root_ = new (arenas_[current_arena_].allocate<EngineMove>(1)) EngineMove(new_root);
+  copyChildren(new_root, *root_);
+  // The rest of the old tree is released at once.
+  arenas_[old_arena].reset();
+}
+
+void Engine::copyChildren(const EngineMove& source, EngineMove& destination) {
+  if (source.children().empty()) {
+    return;
+  }
+  destination.children_ = arenas_[current_arena_].allocate<EngineMove>(source.number_of_children_);
+  for (size_t i = 0; i < source.number_of_children_; ++i) {
+    new (&destination.children_[i]) EngineMove(source.children_[i]);
+    copyChildren(source.children_[i], destination.children_[i]);
+  }
 }
 
 Move Engine::calculateBestMove(const Board& board) {
+  PositionHistory history;
+  history.push(board);
+  return calculateBestMove(board, history);
+}
+
+Move Engine::calculateBestMove(const Board& board, const PositionHistory& history) {
   auto start_time = std::chrono::steady_clock::now();
-  utils::Timer timer;
+  if (opening_book_) {
+    std::optional<Move> book_move = opening_book_->findMove(board, random_generator_());
+    if (book_move) {
+      if (stats_callback_) {
+        MoveStats stats{*book_move, 0, 0ull, 0, 0, 0};
+        stats_callback_(stats);
+      }
+      return *book_move;
+    }
+  }
   nodes_calculated_ = 0ull;
-  Move move(board, 0, 0, 0, 0);
-  EngineMove root(move, 0.0);
+  table_probes_ = 0ull;
+  table_hits_ = 0ull;
+  evaluation_cache_stats_ = {0ull, 0ull};
+  pawn_table_stats_ = {0ull, 0ull};
+  current_ply_ = 0;
+  selective_depth_ = 0;
+  prepareRoot(board);
+  EngineMove& root = *root_;
+  search_history_ = history;
+  if (search_history_.empty() || search_history_.back() != zobrist::hash(board)) {
+    search_history_.push(board);
+  }
+  root_history_index_ = search_history_.size() - 1;
+  if (network_) {
+    accumulators_.resize(std::max<size_t>(accumulators_.size(), 1));
+    network_->refresh(board, accumulators_[0]);
+  }
   time_out_ = false;
-  timer.start(time_for_move_ms_, std::bind(&Engine::timerCallback, this));
-  unsigned depth = 0;
-  for (; depth < depth_; ++depth) {
-    evaluateMove(root);
+  deadline_ = start_time + std::chrono::milliseconds(time_for_move_ms_);
+  unsigned depth = root_depth_;
+  unsigned long long previous_iteration_nodes = 0ull;
+  long first_move_time = -1;
+  long best_move_change_time = 0;
+  std::unique_ptr<Board> best_move_board;
+  active_trace_ = search_trace_ && search_trace_->startSearch() ? search_trace_.get() : nullptr;
+  if (active_trace_) {
+    traceNode(root, SearchTrace::Event::SEARCH_START, SearchTrace::Cutoff::NONE,
+              -kInfiniteScore, kInfiniteScore);
+  }
+  // Deeper search cannot change a forced mate found from the root.
+  while (depth < depth_ && !time_out_ && root.moves_to_mate_ == 0) {
+    const unsigned long long nodes_before_iteration = nodes_calculated_;
+    // Aspiration window around the score of the previous iteration.
+    int window = kAspirationWindow;
+    int alpha = -kInfiniteScore;
+    int beta = kInfiniteScore;
+    if (depth > 0) {
+      alpha = root.getScore() - window;
+      beta = root.getScore() + window;
+    }
+    if (active_trace_) {
+      SearchTrace::Record record{};
+      record.event = SearchTrace::Event::ITERATION_START;
+      record.ply = static_cast<uint8_t>(std::min(depth + 1, 255u));
+      record.alpha = toTraceBound(alpha);
+      record.beta = toTraceBound(beta);
+      active_trace_->add(record);
+    }
+    while (true) {
+      evaluateMove(root, depth + 1, alpha, beta);
+      const int score = root.getScore();
+      if (time_out_ || root.moves_to_mate_ != 0 || (score > alpha && score < beta)) {
+        break;
+      }
+      // Window is widened on the failed side until the score fits.
+      window *= 2;
+      if (score <= alpha) {
+        alpha = std::max(score - window, -kInfiniteScore);
+      } else {
+        beta = std::min(score + window, kInfiniteScore);
+      }
+    }
+    if (!time_out_) {
+      ++depth;
+      if (iteration_callback_) {
+        std::vector<Move> principal_variation;
+        collectPrincipalVariation(root, principal_variation);
+        auto time_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        if (first_move_time < 0) {
+          first_move_time = time_elapsed;
+        }
+        if (!principal_variation.empty() &&
+            (!best_move_board || !(*best_move_board == principal_variation.front().board))) {
+          best_move_board = std::make_unique<Board>(principal_variation.front().board);
+          best_move_change_time = time_elapsed;
+        }
+        const unsigned long long iteration_nodes = nodes_calculated_ - nodes_before_iteration;
+        const double branching_factor = previous_iteration_nodes > 0 ?
+            static_cast<double>(iteration_nodes) / previous_iteration_nodes : 0.0;
+        previous_iteration_nodes = iteration_nodes;
+        IterationStats stats{
+            depth,
+            std::max(depth, selective_depth_),
+            nodes_calculated_,
+            time_elapsed > 0 ? nodes_calculated_ * 1000 / time_elapsed : 0ull,
+            time_elapsed,
+            root.evaluation_,
+            root.moves_to_mate_,
+            table_probes_ > 0 ? static_cast<double>(table_hits_) / table_probes_ : 0.0,
+            evaluation_cache_stats_,
+            pawn_table_stats_,
+            branching_factor,
+            first_move_time,
+            best_move_change_time,
+            principal_variation,
+            collectLines(root)};
+        iteration_callback_(stats);
+      }
+    }
+  }
+  if (active_trace_) {
+    traceNode(root, SearchTrace::Event::SEARCH_END,
+              time_out_ ? getCutoffReason() : SearchTrace::Cutoff::NONE,
+              -kInfiniteScore, kInfiniteScore);
+    active_trace_ = nullptr;
   }
-  timer.stop();
-  if (root.children_.empty()) {
+  root_depth_ = depth;
+  if (root.children().empty()) {
     throw NoValidMoveException(board.createFEN());
   }
   auto result = findBestMove(root);
@@ -250,8 +886,10 @@ Move Engine::calculateBestMove(const Board& board) {
   auto time_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
       end_time - start_time).count();
   if (stats_callback_) {
-    MoveStats stats{result, depth, nodes_calculated_, time_elapsed};
+    MoveStats stats{result, depth, nodes_calculated_, time_elapsed,
+                    root.evaluation_, root.moves_to_mate_};
     stats_callback_(stats);
   }
+  INSTRUMENT_DUMP(std::cerr, "calculateBestMove");
   return result;
 }
@@ -1,15 +1,33 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Arena.h"
+#include "Bitbase.h"
+#include "EvaluationCache.h"
+#include "MateSolver.h"
 #include "MoveCalculator.h"
+#include "Nnue.h"
+#include "OpeningBook.h"
+#include "PawnHashTable.h"
+#include "PositionHistory.h"
+#include "SearchTrace.h"
 
 class EngineMove;
 
+// Engines share no mutable state unless given the same evaluation cache,
+// so any number of them may search in parallel threads. Tables set by
+// setOpeningBook(), addBitbase() and setNetwork() are read-only and may be
+// shared. Each engine keeps its pawn hash table and search tree, which
+// stays as large as the largest tree searched.
 class Engine {
  public:
   struct NoValidMoveException {
@@ -17,21 +35,118 @@ class Engine {
     const std::string fen;
   };
 
+  // Score and moves_to_mate as in IterationStats.
   struct MoveStats {
     const Move move;
     const unsigned depth;
     const unsigned long long nodes;
     const long time_ms;
+    const int score;
+    const int moves_to_mate;
   };
 
+  struct TableStats {
+    unsigned long long hits;
+    unsigned long long misses;
+  };
+
+  // One of the best root moves, in the units of IterationStats.
+  struct Line {
+    const int score;
+    const int moves_to_mate;
+    const std::vector<Move> principal_variation;
+  };
+
+  // Sent after each completed iteration of calculateBestMove.
+  // Score is given in centipawns from white's point of view;
+  // moves_to_mate follows the same sign convention (0 if no mate found).
+  // Nodes and times are counted from the start of calculateBestMove.
+  struct IterationStats {
+    const unsigned depth;
+    // The deepest ply of the search tree.
+    const unsigned selective_depth;
+    const unsigned long long nodes;
+    const unsigned long long nodes_per_second;
+    const long time_ms;
+    const int score;
+    const int moves_to_mate;
+    // Fraction of table probes answered by the table.
+    const double hash_hit_rate;
+    // Probes of the evaluation cache and of the pawn hash table.
+    const TableStats evaluation_cache;
+    const TableStats pawn_table;
+    // Nodes of this iteration divided by nodes of the previous one.
+    const double effective_branching_factor;
+    // When the first iteration was finished.
+    const long first_move_time_ms;
+    // When the current best move became the best.
+    const long best_move_change_time_ms;
+    const std::vector<Move> principal_variation;
+    // The best root moves, best first, as many as set by setMultiPV().
+    const std::vector<Line> lines;
+  };
+
+  using MateSolution = MateSolver::Solution;
+
   Engine(unsigned depth, unsigned time_for_move_ms);
+  ~Engine();
+
+  // Search tree built for the previous call is kept and re-rooted
+  // at |board| if it is reachable within two plies.
   Move calculateBestMove(const Board& board);
+  // |history| holds positions of the game up to and including |board|;
+  // repetitions of them are scored as draws.
+  Move calculateBestMove(const Board& board, const PositionHistory& history);
   void setStatsCallback(std::function<void(MoveStats)> callback);
+  void setIterationCallback(std::function<void(IterationStats)> callback);
+
+  // Makes choices between equally evaluated moves reproducible.
+  void setRandomSeed(unsigned seed);
+
+  void setDepth(unsigned depth);
+  void setTimeForMove(unsigned time_for_move_ms);
+  // Search stops after |nodes| evaluations, 0 means no limit.
+  void setNodesLimit(unsigned long long nodes);
+  // Iteration stats carry lines of the |lines| best root moves.
+  void setMultiPV(unsigned lines);
+
+  // Makes the running calculateBestMove return as soon as possible.
+  // May be called from any thread.
+  void stop();
+
+  // Looks only for a forced mate of the side to move in at most |max_moves|
+  // moves, using proof-number search. Limited by time for move.
+  MateSolution solveMate(const Board& board, unsigned max_moves);
+
+  // Static evaluation in centipawns from white's point of view.
+  static int evaluate(const Board& board);
+
+  // Positions found in |book| are answered with a book move without search.
+  void setOpeningBook(std::shared_ptr<const OpeningBook> book);
+
+  // Positions covered by |bitbase| are scored from the table and not searched further.
+  void addBitbase(std::shared_ptr<const Bitbase> bitbase);
+
+  // Positions are evaluated by |network| instead of counting material,
+  // null brings material back.
+  void setNetwork(std::shared_ptr<const Nnue> network);
+
+  // Replaces the engine's own evaluation cache, e.g. to share one among
+  // many engines. Engines sharing a cache have to use the same network.
+  void setEvaluationCache(std::shared_ptr<EvaluationCache> cache);
+
+  // Node visits of sampled searches are written to |trace|.
+  // A trace may be used by only one engine at a time.
+  void setSearchTrace(std::shared_ptr<SearchTrace> trace);
 
  private:
-  void evaluateMove(EngineMove& engine_move) const;
+  // Searches |engine_move| |depth| plies deep within window (|alpha|, |beta|)
+  // of white-relative scores.
+  void evaluateMove(EngineMove& engine_move, unsigned depth, int alpha, int beta) const;
+  void searchChildren(EngineMove& engine_move, unsigned depth, int alpha, int beta) const;
   Move findBestMove(const EngineMove& move) const;
-  float calculateMoveEvaluation(const Move& move) const;
+  float calculateMoveEvaluation(const Board& parent_board, const Move& move, uint64_t hash) const;
+  int evaluatePosition(const Board& board) const;
   void updateBestEvaluation(EngineMove& move) const;
   void updateMovesToMate(EngineMove& move) const;
   void findBorderValuesInChildren(
@@ -41,13 +156,58 @@ class Engine {
       int& the_biggest_negative_value,
       int& the_lowest_positive_value,
       bool& is_move_without_mate) const;
-  void timerCallback();
+  bool probeBitbases(EngineMove& move) const;
+  void prepareRoot(const Board& board);
+  void moveToFreshArena(const EngineMove& new_root);
+  void copyChildren(const EngineMove& source, EngineMove& destination);
+  bool isRepetition(const EngineMove& move) const;
+  void markAsDraw(EngineMove& move, int alpha, int beta) const;
+  SearchTrace::Cutoff getCutoffReason(const EngineMove& move) const;
+  SearchTrace::Cutoff getCutoffReason() const;
+  void traceNode(const EngineMove& move, SearchTrace::Event event, SearchTrace::Cutoff cutoff,
+                 int alpha, int beta) const;
+  void collectPrincipalVariation(const EngineMove& move, std::vector<Move>& variation) const;
+  std::vector<Line> collectLines(const EngineMove& root) const;
 
-  bool time_out_{false};
+  mutable std::atomic<bool> time_out_{false};
+  // Search stops once an expansion finishes after the deadline.
+  std::chrono::steady_clock::time_point deadline_;
   unsigned depth_{1};
   unsigned time_for_move_ms_{1000};
+  unsigned long long nodes_limit_{0ull};
+  unsigned multi_pv_{1};
   std::function<void(MoveStats)> stats_callback_;
+  std::function<void(IterationStats)> iteration_callback_;
+  std::shared_ptr<const OpeningBook> opening_book_;
+  std::vector<std::shared_ptr<const Bitbase>> bitbases_;
   mutable unsigned long long nodes_calculated_{0ull};
+  mutable unsigned long long table_probes_{0ull};
+  mutable unsigned long long table_hits_{0ull};
+  std::shared_ptr<SearchTrace> search_trace_;
+  std::shared_ptr<const Nnue> network_;
+  // Network accumulators of positions on the path from the root, by ply.
+  mutable std::vector<Nnue::Accumulator> accumulators_;
+  std::shared_ptr<EvaluationCache> evaluation_cache_;
+  mutable PawnHashTable pawn_table_;
+  mutable TableStats evaluation_cache_stats_{0ull, 0ull};
+  mutable TableStats pawn_table_stats_{0ull, 0ull};
+  // Trace of the running search, null if it is not sampled.
+  SearchTrace* active_trace_{nullptr};
+  // Game history followed by the path from the root to the searched move.
+  mutable PositionHistory search_history_;
+  size_t root_history_index_{0};
+  mutable unsigned current_ply_{0};
+  mutable unsigned selective_depth_{0};
+  // Children in search order, by ply.
+  mutable std::vector<std::vector<EngineMove*>> search_orders_;
+  // Search tree lives in one of two arenas. When the tree is re-rooted,
+  // the kept subtree is copied to the other one and the old arena is reset.
+  mutable Arena arenas_[2];
+  size_t current_arena_{0};
+  EngineMove* root_{nullptr};
+  std::unique_ptr<MateSolver> mate_solver_;
+  unsigned root_depth_{0};
+  mutable std::mt19937 random_generator_;
 };
 
 #endif // ENGINE_H
@@ -1,9 +1,18 @@
 /* Component tests for class Engine */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "Bitbase.h"
 #include "Engine.h"
+#include "Zobrist.h"
 #include "utils/Mock.h"
 #include "utils/Test.h"
 
@@ -48,4 +57,419 @@ TEST_PROCEDURE(Engine_finds_mate_in_one) {
   TEST_END
 }
 
+TEST_PROCEDURE(Engine_reuses_search_tree) {
+  TEST_START
+  unsigned long long nodes = 0ull;
+  Engine engine(3, 5000);
+  engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+  Board board("8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1");
+  Move move = engine.calculateBestMove(board);
+  VERIFY_TRUE(nodes > 0ull);
+
+  engine.calculateBestMove(board);
+  VERIFY_EQUALS(nodes, 0ull);
+
+  MoveCalculator calculator(move.board);
+  Move reply = calculator.calculateAllMoves().front();
+  engine.calculateBestMove(reply.board);
+  const unsigned long long nodes_for_reused_search = nodes;
+  Engine fresh_engine(3, 5000);
+  fresh_engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+  fresh_engine.calculateBestMove(reply.board);
+  VERIFY_TRUE(nodes_for_reused_search < nodes);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_plays_book_move_without_search) {
+  TEST_START
+  Board board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  const std::string path = "/tmp/engine_tests_book.bin";
+  {
+    // One entry: e2e4 with weight 1.
+    const uint64_t key = zobrist::hash(board);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      file.put(static_cast<char>((key >> shift) & 0xFF));
+    }
+    const uint16_t e2e4 = 4 | (3 << 3) | (4 << 6) | (1 << 9);
+    const char rest[] = {static_cast<char>(e2e4 >> 8), static_cast<char>(e2e4 & 0xFF), 0, 1, 0, 0, 0, 0};
+    file.write(rest, sizeof(rest));
+  }
+  unsigned long long nodes = 1ull;
+  Engine engine(3, 5000);
+  engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+  engine.setOpeningBook(std::make_shared<OpeningBook>(path));
+  Move move = engine.calculateBestMove(board);
+  VERIFY_TRUE(MovesEqual(move, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1"));
+  VERIFY_EQUALS(nodes, 0ull);
+  std::remove(path.c_str());
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_uses_bitbase) {
+  TEST_START
+  // Table in which every position is a draw except the one after Qa8.
+  std::vector<int8_t> values(Bitbase::getNumberOfPositions("KQK"), 0);
+  size_t index;
+  VERIFY_TRUE(Bitbase::calculateIndex("KQK", Board("Q7/8/3k4/8/8/8/8/4K3 b - - 1 1"), index));
+  values[index] = -9;
+  const std::string path = "/tmp/engine_tests_KQK.bb";
+  Bitbase::write(path, "KQK", values);
+
+  Engine engine(2, 5000);
+  engine.addBitbase(std::make_shared<Bitbase>(path));
+  Move move = engine.calculateBestMove(Board("8/8/3k4/8/8/8/8/Q3K3 w - - 0 1"));
+  VERIFY_TRUE(MovesEqual(move, "Q7/8/3k4/8/8/8/8/4K3 b - - 1 1"));
+  std::remove(path.c_str());
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_solves_mates) {
+  TEST_START
+  Engine engine(1, 60000);
+  {
+    // 1. Ra6 bxa6 2. b7#
+    Engine::MateSolution solution = engine.solveMate(Board("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1"), 3);
+    VERIFY_TRUE(solution.found);
+    VERIFY_EQUALS(solution.moves_to_mate, 2u);
+    VERIFY_EQUALS(solution.line.size(), 3lu);
+    VERIFY_TRUE(MovesEqual(solution.line[0], "kbK5/pp6/RP6/8/8/8/8/8 b - - 1 1"));
+    VERIFY_TRUE(MoveCalculator(solution.line.back().board).calculateAllMoves().empty());
+  }
+  {
+    Engine::MateSolution solution = engine.solveMate(Board("8/1Q6/8/8/8/4K3/2k5/8 w - - 0 1"), 5);
+    VERIFY_TRUE(solution.found);
+    VERIFY_EQUALS(solution.moves_to_mate, 3u);
+    VERIFY_EQUALS(solution.line.size(), 5lu);
+  }
+  {
+    Engine::MateSolution solution = engine.solveMate(Board("5k2/K7/8/8/8/7Q/8/8 w - - 0 1"), 6);
+    VERIFY_TRUE(solution.found);
+    VERIFY_EQUALS(solution.moves_to_mate, 5u);
+    VERIFY_EQUALS(solution.line.size(), 9lu);
+    VERIFY_TRUE(MoveCalculator(solution.line.back().board).isCheck());
+  }
+  {
+    Engine::MateSolution solution = engine.solveMate(Board("5k2/K7/8/8/8/7Q/8/8 w - - 0 1"), 4);
+    VERIFY_FALSE(solution.found);
+  }
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_reports_iterations) {
+  TEST_START
+  std::vector<unsigned> depths;
+  std::vector<size_t> variation_lengths;
+  Engine engine(3, 5000);
+  std::vector<double> branching_factors;
+  bool times_are_ordered = true;
+  engine.setIterationCallback([&](Engine::IterationStats stats) {
+    depths.push_back(stats.depth);
+    variation_lengths.push_back(stats.principal_variation.size());
+    branching_factors.push_back(stats.effective_branching_factor);
+    times_are_ordered = times_are_ordered &&
+        stats.selective_depth >= stats.depth &&
+        stats.first_move_time_ms <= stats.best_move_change_time_ms &&
+        stats.best_move_change_time_ms <= stats.time_ms;
+  });
+  engine.calculateBestMove(Board("8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1"));
+  VERIFY_EQUALS(depths, std::vector<unsigned>({1, 2, 3}));
+  VERIFY_EQUALS(variation_lengths, std::vector<size_t>({1, 2, 3}));
+  VERIFY_TRUE(times_are_ordered);
+  VERIFY_EQUALS(branching_factors.size(), 3lu);
+  VERIFY_EQUALS(branching_factors[0], 0.0);
+  VERIFY_TRUE(branching_factors[1] > 1.0);
+  // With pruning an iteration may take fewer nodes than the one before.
+  VERIFY_TRUE(branching_factors[2] > 0.0);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_respects_nodes_limit) {
+  TEST_START
+  unsigned long long nodes = 0ull;
+  unsigned depth = 0;
+  Engine engine(6, 60000);
+  engine.setNodesLimit(1000ull);
+  engine.setStatsCallback([&](Engine::MoveStats stats) {
+    nodes = stats.nodes;
+    depth = stats.depth;
+  });
+  engine.calculateBestMove(Board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+  VERIFY_TRUE(nodes >= 1000ull);
+  VERIFY_TRUE(nodes < 2000ull);
+  VERIFY_TRUE(depth < 6u);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_scores_repetition_as_draw) {
+  TEST_START
+  // Black is a queen up; white's Kh1 repeats a position for the third time.
+  PositionHistory history;
+  history.push(Board("1q5k/8/8/8/8/8/8/6K1 w - - 4 8"));
+  history.push(Board("1q5k/8/8/8/8/8/8/7K b - - 5 8"));
+  history.push(Board("1q4k1/8/8/8/8/8/8/7K w - - 6 9"));
+  history.push(Board("1q4k1/8/8/8/8/8/8/6K1 b - - 7 9"));
+  history.push(Board("1q5k/8/8/8/8/8/8/6K1 w - - 8 10"));
+  history.push(Board("1q5k/8/8/8/8/8/8/7K b - - 9 10"));
+  history.push(Board("1q4k1/8/8/8/8/8/8/7K w - - 10 11"));
+  history.push(Board("1q4k1/8/8/8/8/8/8/6K1 b - - 11 11"));
+  const Board board("1q5k/8/8/8/8/8/8/6K1 w - - 12 12");
+  history.push(board);
+  Engine engine(2, 5000);
+  int score = 1;
+  engine.setStatsCallback([&score](Engine::MoveStats stats) { score = stats.score; });
+  Move move = engine.calculateBestMove(board, history);
+  VERIFY_TRUE(MovesEqual(move, "1q5k/8/8/8/8/8/8/7K b - - 13 12"));
+  VERIFY_EQUALS(score, 0);
+
+  // Without the history the queen is simply missing.
+  Engine other_engine(2, 5000);
+  other_engine.setStatsCallback([&score](Engine::MoveStats stats) { score = stats.score; });
+  other_engine.calculateBestMove(board);
+  VERIFY_EQUALS(score, -900);
+  TEST_END
+}
+
+// Minimax over |depth| plies of network evaluations, from white's point of view.
+int searchWithNetwork(const Nnue& network, const Board& board, unsigned depth) {
+  if (depth == 0) {
+    const int score = network.evaluate(board);
+    return board.whiteToMove() ? score : -score;
+  }
+  int result = board.whiteToMove() ? -10000 : 10000;
+  for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+    const int score = searchWithNetwork(network, move.board, depth - 1);
+    result = board.whiteToMove() ? std::max(result, score) : std::min(result, score);
+  }
+  return result;
+}
+
+TEST_PROCEDURE(Engine_evaluates_with_network) {
+  TEST_START
+  const std::string path = "/tmp/engine_tests.nnue";
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> weight(-12, 12);
+  Nnue::Weights weights;
+  for (size_t i = 0; i < Nnue::kHiddenSize; ++i) {
+    weights.feature_biases.push_back(32);
+  }
+  for (size_t i = 0; i < Nnue::kNumberOfFeatures * Nnue::kHiddenSize; ++i) {
+    weights.feature_weights.push_back(weight(generator));
+  }
+  for (size_t i = 0; i < 2 * Nnue::kHiddenSize; ++i) {
+    weights.output_weights.push_back(weight(generator));
+  }
+  Nnue::write(path, weights);
+  auto network = std::make_shared<Nnue>(path);
+  std::remove(path.c_str());
+  const Board board("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  Engine engine(3, 60000);
+  engine.setNetwork(network);
+  int score = 0;
+  engine.setStatsCallback([&score](Engine::MoveStats stats) { score = stats.score; });
+  engine.calculateBestMove(board);
+  VERIFY_EQUALS(score, searchWithNetwork(*network, board, 3));
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_reports_multiple_lines) {
+  TEST_START
+  const Board board("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  std::vector<Engine::IterationStats> single_line;
+  std::vector<Engine::IterationStats> multiple_lines;
+  for (unsigned lines: {1u, 4u}) {
+    Engine engine(3, 60000);
+    engine.setMultiPV(lines);
+    auto& iterations = lines == 1 ? single_line : multiple_lines;
+    engine.setIterationCallback([&iterations](Engine::IterationStats stats) {
+      iterations.push_back(stats);
+    });
+    engine.calculateBestMove(board);
+  }
+  VERIFY_EQUALS(multiple_lines.size(), 3lu);
+  // Lines come from the same search, which proves less about the other moves.
+  VERIFY_TRUE(multiple_lines.back().nodes >= single_line.back().nodes);
+  VERIFY_TRUE(multiple_lines.back().nodes < 4 * single_line.back().nodes);
+  VERIFY_EQUALS(single_line.back().lines.size(), 1lu);
+  for (const Engine::IterationStats& stats: multiple_lines) {
+    VERIFY_EQUALS(stats.lines.size(), 4lu);
+    VERIFY_EQUALS(stats.lines[0].score, stats.score);
+    VERIFY_EQUALS(stats.lines[0].principal_variation.size(), stats.principal_variation.size());
+    VERIFY_TRUE(stats.lines[0].principal_variation.front().board ==
+                stats.principal_variation.front().board);
+    for (size_t i = 1; i < stats.lines.size(); ++i) {
+      VERIFY_TRUE(stats.lines[i - 1].score >= stats.lines[i].score);
+      VERIFY_EQUALS(stats.lines[i].principal_variation.size(), stats.depth);
+      VERIFY_FALSE(stats.lines[i].principal_variation.front().board ==
+                   stats.lines[0].principal_variation.front().board);
+    }
+  }
+  // Score of each line is the score of a search from its first move.
+  const Engine::Line& second = multiple_lines.back().lines[1];
+  int score = 0;
+  Engine engine(2, 60000);
+  engine.setStatsCallback([&score](Engine::MoveStats stats) { score = stats.score; });
+  engine.calculateBestMove(second.principal_variation.front().board);
+  VERIFY_EQUALS(score, second.score);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_caches_evaluations) {
+  TEST_START
+  const Board board("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  Engine engine(3, 60000);
+  std::vector<Engine::IterationStats> iterations;
+  engine.setIterationCallback([&iterations](Engine::IterationStats stats) {
+    iterations.push_back(stats);
+  });
+  int score = 0;
+  engine.setStatsCallback([&score](Engine::MoveStats stats) { score = stats.score; });
+  engine.calculateBestMove(board);
+  VERIFY_EQUALS(iterations.size(), 3lu);
+  const Engine::IterationStats& last = iterations.back();
+  // Every evaluated leaf probes the cache once.
+  VERIFY_EQUALS(last.evaluation_cache.hits + last.evaluation_cache.misses, last.nodes);
+  // Different move orders reach the same positions at depth 3.
+  VERIFY_TRUE(last.evaluation_cache.hits > 0ull);
+  VERIFY_EQUALS(last.pawn_table.hits + last.pawn_table.misses, last.evaluation_cache.misses);
+  VERIFY_TRUE(last.pawn_table.hits > last.pawn_table.misses);
+  // Same result as without the tables.
+  int expected = -10000;
+  for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+    int reply_score = 10000;
+    for (const Move& reply: MoveCalculator(move.board).calculateAllMoves()) {
+      int best_score = -10000;
+      for (const Move& last_move: MoveCalculator(reply.board).calculateAllMoves()) {
+        best_score = std::max(best_score, Engine::evaluate(last_move.board));
+      }
+      reply_score = std::min(reply_score, best_score);
+    }
+    expected = std::max(expected, reply_score);
+  }
+  VERIFY_EQUALS(score, expected);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_prunes_with_windows) {
+  TEST_START
+  const Board board("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  unsigned long long full_width_nodes = 0ull;
+  for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+    ++full_width_nodes;
+    for (const Move& reply: MoveCalculator(move.board).calculateAllMoves()) {
+      full_width_nodes += 1 + MoveCalculator(reply.board).calculateAllMoves().size();
+    }
+  }
+  Engine engine(3, 60000);
+  unsigned long long nodes = 0ull;
+  engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+  engine.calculateBestMove(board);
+  VERIFY_TRUE(nodes * 2 < full_width_nodes);
+  TEST_END
+}
+
+TEST_PROCEDURE(Engine_writes_search_trace) {
+  TEST_START
+  const std::string path = "/tmp/engine_tests_search.trace";
+  unsigned long long nodes = 0ull;
+  {
+    auto trace = std::make_shared<SearchTrace>(path, 2);
+    Engine engine(3, 5000);
+    engine.setSearchTrace(trace);
+    engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+    engine.calculateBestMove(Board("8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1"));
+    // Only every second search is recorded.
+    Engine other_engine(3, 5000);
+    other_engine.setSearchTrace(trace);
+    other_engine.calculateBestMove(Board("8/8/8/3k4/4Q3/8/8/4K3 b - - 0 1"));
+  }
+  const auto records = SearchTrace::readFile(path);
+  std::remove(path.c_str());
+  VERIFY_TRUE(records.size() > 2lu);
+  VERIFY_TRUE(records.front().event == SearchTrace::Event::SEARCH_START);
+  VERIFY_TRUE(records.back().event == SearchTrace::Event::SEARCH_END);
+  unsigned searches = 0;
+  unsigned iterations = 0;
+  unsigned long long generated_moves = 0ull;
+  unsigned max_ply = 0;
+  for (const auto& record: records) {
+    if (record.event == SearchTrace::Event::SEARCH_START) {
+      ++searches;
+    } else if (record.event == SearchTrace::Event::ITERATION_START) {
+      ++iterations;
+    } else if (record.event == SearchTrace::Event::EXPANSION) {
+      generated_moves += record.children;
+      max_ply = std::max(max_ply, static_cast<unsigned>(record.ply));
+    }
+    if (record.event == SearchTrace::Event::SEARCH_START ||
+        record.event == SearchTrace::Event::SEARCH_END) {
+      VERIFY_EQUALS(record.alpha, SearchTrace::kNoBound);
+    }
+    VERIFY_TRUE(record.event != SearchTrace::Event::DROPPED);
+  }
+  VERIFY_EQUALS(searches, 1u);
+  VERIFY_EQUALS(iterations, 3u);
+  VERIFY_EQUALS(max_ply, 2u);
+  VERIFY_EQUALS(generated_moves, nodes);
+  TEST_END
+}
+
+// Moves and node counts of a short game played by |engine| against itself.
+std::vector<std::string> playGame(Engine& engine, const Board& board, size_t plies) {
+  std::vector<std::string> results;
+  unsigned long long nodes = 0ull;
+  engine.setStatsCallback([&nodes](Engine::MoveStats stats) { nodes = stats.nodes; });
+  PositionHistory history;
+  history.push(board);
+  Board position = board;
+  for (size_t ply = 0; ply < plies; ++ply) {
+    const Move move = engine.calculateBestMove(position, history);
+    results.push_back(move.board.createFEN() + " " + std::to_string(nodes));
+    position = move.board;
+    history.push(position);
+  }
+  return results;
+}
+
+TEST_PROCEDURE(Engine_searches_in_parallel_threads) {
+  TEST_START
+  constexpr size_t kEngines = 32;
+  constexpr size_t kPlies = 4;
+  const Board board("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+  std::vector<std::vector<std::string>> expected;
+  for (size_t i = 0; i < kEngines; ++i) {
+    Engine engine(3, 60000);
+    engine.setRandomSeed(i);
+    expected.push_back(playGame(engine, board, kPlies));
+  }
+
+  // Engines share an evaluation cache, which gives the same scores.
+  auto cache = std::make_shared<EvaluationCache>();
+  std::vector<std::vector<std::string>> results(kEngines);
+  std::vector<long> timed_search_ms(kEngines);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kEngines; ++i) {
+    threads.emplace_back([&, i]() {
+      Engine engine(3, 60000);
+      engine.setRandomSeed(i);
+      engine.setEvaluationCache(cache);
+      results[i] = playGame(engine, board, kPlies);
+      // Deadline holds with all threads busy.
+      Engine timed_engine(30, 50);
+      const auto start = std::chrono::steady_clock::now();
+      timed_engine.calculateBestMove(board);
+      timed_search_ms[i] = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start).count();
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < kEngines; ++i) {
+    VERIFY_EQUALS(results[i], expected[i]);
+    VERIFY_TRUE(timed_search_ms[i] < 2000);
+  }
+  TEST_END
+}
+
 }  // unnamed namespace
@@ -0,0 +1,37 @@
+#include "EvaluationCache.h"
+
+
+EvaluationCache::EvaluationCache(size_t size_in_bytes) {
+  size_t number_of_entries = 1;
+  while (number_of_entries * 2 * sizeof(Entry) <= size_in_bytes) {
+    number_of_entries *= 2;
+  }
+  entries_.reset(new Entry[number_of_entries]);
+  mask_ = number_of_entries - 1;
+  clear();
+}
+
+bool EvaluationCache::probe(uint64_t key, int& score) const {
+  const Entry& entry = entries_[key & mask_];
+  const uint64_t data = entry.data.load(std::memory_order_relaxed);
+  if ((entry.checked_key.load(std::memory_order_relaxed) ^ data) != key) {
+    return false;
+  }
+  score = static_cast<int32_t>(static_cast<uint32_t>(data));
+  return true;
+}
+
+void EvaluationCache::store(uint64_t key, int score) {
+  Entry& entry = entries_[key & mask_];
+  const uint64_t data = static_cast<uint32_t>(static_cast<int32_t>(score));
+  entry.checked_key.store(key ^ data, std::memory_order_relaxed);
+  entry.data.store(data, std::memory_order_relaxed);
+}
+
+void EvaluationCache::clear() {
+  for (size_t i = 0; i <= mask_; ++i) {
+    // Empty entry matches only key 0, which is as unlikely as any collision.
+    entries_[i].checked_key.store(0ull, std::memory_order_relaxed);
+    entries_[i].data.store(0ull, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef EVALUATION_CACHE_H
+#define EVALUATION_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Lossy table of static evaluations keyed by position hash. An entry is
+// replaced by every store. Key is kept XOR-ed with the data, so an entry torn
+// by concurrent stores reads as a miss: the table may be shared between
+// threads without locks.
+class EvaluationCache {
+ public:
+  static constexpr size_t kDefaultSizeInBytes = 2u << 20;
+
+  // Number of entries is |size_in_bytes| rounded down to a power of two.
+  EvaluationCache(size_t size_in_bytes = kDefaultSizeInBytes);
+
+  EvaluationCache(const EvaluationCache&) = delete;
+  EvaluationCache& operator=(const EvaluationCache&) = delete;
+
+  bool probe(uint64_t key, int& score) const;
+  void store(uint64_t key, int score);
+  void clear();
+
+ private:
+  struct Entry {
+    std::atomic<uint64_t> checked_key;
+    std::atomic<uint64_t> data;
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t mask_{0};
+};
+
+#endif  // EVALUATION_CACHE_H
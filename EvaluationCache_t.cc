@@ -0,0 +1,73 @@
+/* Component tests for classes EvaluationCache and PawnHashTable */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "EvaluationCache.h"
+#include "PawnHashTable.h"
+#include "utils/Test.h"
+
+namespace {
+
+TEST_PROCEDURE(EvaluationCache_stores_scores) {
+  TEST_START
+  EvaluationCache cache(1024);
+  int score = 0;
+  VERIFY_FALSE(cache.probe(0x1234ull, score));
+  cache.store(0x1234ull, -250);
+  VERIFY_TRUE(cache.probe(0x1234ull, score));
+  VERIFY_EQUALS(score, -250);
+  // 64 entries: the key with the same index replaces the entry.
+  cache.store(0x1234ull + 64, 17);
+  VERIFY_FALSE(cache.probe(0x1234ull, score));
+  VERIFY_TRUE(cache.probe(0x1234ull + 64, score));
+  VERIFY_EQUALS(score, 17);
+  cache.clear();
+  VERIFY_FALSE(cache.probe(0x1234ull + 64, score));
+  TEST_END
+}
+
+TEST_PROCEDURE(EvaluationCache_is_shared_without_locks) {
+  TEST_START
+  // Every thread stores scores derived from keys into few entries;
+  // a probe may miss, but it never returns a score of another key.
+  EvaluationCache cache(256);
+  std::atomic<bool> wrong_score{false};
+  std::vector<std::thread> threads;
+  for (unsigned thread = 0; thread < 4; ++thread) {
+    threads.emplace_back([&cache, &wrong_score, thread]() {
+      for (uint64_t i = 1; i < 200000; ++i) {
+        const uint64_t key = i * 0x9E3779B97F4A7C15ull + thread;
+        const int expected = static_cast<int>(key % 20001) - 10000;
+        cache.store(key, expected);
+        int score;
+        if (cache.probe(key, score) && score != expected) {
+          wrong_score = true;
+        }
+      }
+    });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  VERIFY_FALSE(wrong_score);
+  TEST_END
+}
+
+TEST_PROCEDURE(PawnHashTable_stores_scores) {
+  TEST_START
+  PawnHashTable table;
+  int score = 0;
+  VERIFY_FALSE(table.probe(0xFF00ull, 0x00FFull, score));
+  table.store(0xFF00ull, 0x00FFull, 35);
+  VERIFY_TRUE(table.probe(0xFF00ull, 0x00FFull, score));
+  VERIFY_EQUALS(score, 35);
+  VERIFY_FALSE(table.probe(0x00FFull, 0xFF00ull, score));
+  // No pawns at all is a valid key too.
+  table.store(0ull, 0ull, 0);
+  VERIFY_TRUE(table.probe(0ull, 0ull, score));
+  TEST_END
+}
+
+}  // unnamed namespace
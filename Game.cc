@@ -1,10 +1,15 @@
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <string>
 
+#include "Bitbase.h"
 #include "Board.h"
 #include "Engine.h"
 #include "MoveCalculator.h"
+#include "OpeningBook.h"
+#include "PositionHistory.h"
 
 namespace {
 
@@ -64,22 +69,72 @@ void statsCollector(Engine::MoveStats stats) {
   std::cerr << "==========================" << std::endl;
 }
 
+void iterationCollector(Engine::IterationStats stats) {
+  std::cerr << "depth " << stats.depth << "/" << stats.selective_depth
+            << " score " << stats.score
+            << " nodes " << stats.nodes
+            << " nps " << stats.nodes_per_second
+            << " ebf " << stats.effective_branching_factor
+            << " hash hits " << stats.hash_hit_rate
+            << " eval cache " << stats.evaluation_cache.hits << "/"
+            << stats.evaluation_cache.hits + stats.evaluation_cache.misses
+            << " pawn table " << stats.pawn_table.hits << "/"
+            << stats.pawn_table.hits + stats.pawn_table.misses
+            << " time " << stats.time_ms
+            << " first move " << stats.first_move_time_ms
+            << " best move change " << stats.best_move_change_time_ms
+            << " pv";
+  for (const Move& move: stats.principal_variation) {
+    std::cerr << " " << move;
+  }
+  std::cerr << std::endl;
+}
+
 }  // unnamed namespace
 
-int main() {
+int main(int argc, char* argv[]) {
   PGNCreator pgn_creator(std::cout);
   Engine engine(6, 5000);
   engine.setStatsCallback(statsCollector);
+  engine.setIterationCallback(iterationCollector);
+  // Arguments: optional opening book, network (*.nnue) and any number of bitbases (*.bb).
+  for (int i = 1; i < argc; ++i) {
+    const std::string path = argv[i];
+    try {
+      if (path.size() > 3 && path.substr(path.size() - 3) == ".bb") {
+        engine.addBitbase(std::make_shared<Bitbase>(path));
+      } else if (path.size() > 5 && path.substr(path.size() - 5) == ".nnue") {
+        engine.setNetwork(std::make_shared<Nnue>(path));
+      } else {
+        engine.setOpeningBook(std::make_shared<OpeningBook>(path));
+      }
+    } catch (MappedFile::MappingFailedException& e) {
+      std::cerr << "Cannot open " << e.path << std::endl;
+      return 1;
+    } catch (OpeningBook::InvalidBookException& e) {
+      std::cerr << "Invalid opening book " << e.path << std::endl;
+      return 1;
+    } catch (Bitbase::InvalidBitbaseException& e) {
+      std::cerr << "Invalid bitbase " << e.path << std::endl;
+      return 1;
+    } catch (Nnue::InvalidNetworkException& e) {
+      std::cerr << "Invalid network " << e.path << std::endl;
+      return 1;
+    }
+  }
   Board board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  PositionHistory history;
+  history.push(board);
   bool cont = true;
   bool was_mate = false;
 
   while (cont) {
     try {
-      Move move = engine.calculateBestMove(board);
+      Move move = engine.calculateBestMove(board, history);
       pgn_creator.onMoveMade(move);
       board = move.board;
-      cont = cont && !move.insufficient_material;
+      history.push(board);
+      cont = cont && !move.insufficient_material && !history.isDrawByRule(board);
     } catch (Engine::NoValidMoveException&) {
       cont = false;
       was_mate = true;
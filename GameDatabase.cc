@@ -0,0 +1,345 @@
+#include "GameDatabase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <queue>
+
+#include "OpeningBook.h"
+#include "PgnReader.h"
+#include "Zobrist.h"
+
+namespace {
+
+constexpr char kVersion = 1;
+constexpr size_t kOutputBufferEntries = 1u << 12;
+
+struct Header {
+  char magic[4];
+  char version;
+  char zero[3];
+  uint64_t games;
+  uint64_t move_entries;
+  uint64_t game_entries;
+};
+
+static_assert(sizeof(Header) == GameDatabase::kHeaderSize, "Header size is part of the format");
+static_assert(sizeof(GameDatabase::MoveEntry) == 32, "Move entries are stored as they are");
+static_assert(sizeof(GameDatabase::GameEntry) == 16, "Game entries are stored as they are");
+
+bool isLess(const GameDatabase::MoveEntry& first, const GameDatabase::MoveEntry& second) {
+  return first.key < second.key || (first.key == second.key && first.move < second.move);
+}
+
+bool isLess(const GameDatabase::GameEntry& first, const GameDatabase::GameEntry& second) {
+  return first.key < second.key || (first.key == second.key && first.game < second.game);
+}
+
+// Adds results of |next| to |last| if both describe the same move.
+bool combine(GameDatabase::MoveEntry& last, const GameDatabase::MoveEntry& next) {
+  if (last.key != next.key || last.move != next.move) {
+    return false;
+  }
+  for (size_t i = 0; i < static_cast<size_t>(GameDatabase::Result::LAST); ++i) {
+    last.results[i] += next.results[i];
+  }
+  return true;
+}
+
+// Games are distinct, nothing to combine.
+bool combine(GameDatabase::GameEntry&, const GameDatabase::GameEntry&) {
+  return false;
+}
+
+template <typename Entry>
+void sortAndCombine(std::vector<Entry>& entries) {
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& first, const Entry& second) { return isLess(first, second); });
+  auto last = entries.begin();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it == entries.begin() || !combine(*last, *it)) {
+      if (it != entries.begin()) {
+        ++last;
+      }
+      *last = *it;
+    }
+  }
+  entries.erase(entries.empty() ? entries.end() : last + 1, entries.end());
+}
+
+template <typename Entry>
+void writeEntries(std::ofstream& output, const std::vector<Entry>& entries) {
+  output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+}
+
+// Merges sorted runs from files |run_paths| and the sorted |entries| into
+// |output|. Returns number of written entries.
+template <typename Entry>
+size_t mergeRuns(const std::vector<std::string>& run_paths, const std::vector<Entry>& entries,
+                 std::ofstream& output) {
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<std::pair<const Entry*, const Entry*>> sources;
+  for (const std::string& path: run_paths) {
+    files.push_back(std::make_unique<MappedFile>(path));
+    files.back()->adviseSequentialAccess();
+    const Entry* first = reinterpret_cast<const Entry*>(files.back()->data());
+    sources.emplace_back(first, first + files.back()->size() / sizeof(Entry));
+  }
+  if (!entries.empty()) {
+    sources.emplace_back(entries.data(), entries.data() + entries.size());
+  }
+  auto greater = [&sources](size_t first, size_t second) {
+    return isLess(*sources[second].first, *sources[first].first);
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+  for (size_t source = 0; source < sources.size(); ++source) {
+    queue.push(source);
+  }
+  std::vector<Entry> buffer;
+  buffer.reserve(kOutputBufferEntries);
+  size_t written = 0;
+  while (!queue.empty()) {
+    const size_t source = queue.top();
+    queue.pop();
+    const Entry& entry = *sources[source].first++;
+    if (buffer.empty() || !combine(buffer.back(), entry)) {
+      if (buffer.size() == kOutputBufferEntries) {
+        writeEntries(output, buffer);
+        written += buffer.size();
+        buffer.clear();
+      }
+      buffer.push_back(entry);
+    }
+    if (sources[source].first != sources[source].second) {
+      queue.push(source);
+    }
+  }
+  writeEntries(output, buffer);
+  return written + buffer.size();
+}
+
+template <typename Entry>
+GameDatabase::Entries<Entry> findEntries(const Entry* entries, size_t size, uint64_t key) {
+  auto range = std::equal_range(entries, entries + size, Entry{key},
+      [](const Entry& first, const Entry& second) { return first.key < second.key; });
+  return {range.first, range.second};
+}
+
+}  // unnamed namespace
+
+constexpr char GameDatabase::kMagic[];
+
+GameDatabase::GameDatabase(const std::string& path) : file_(path) {
+  Header header;
+  if (file_.size() < kHeaderSize) {
+    throw InvalidFileException(path);
+  }
+  memcpy(&header, file_.data(), kHeaderSize);
+  if (memcmp(header.magic, kMagic, 4) != 0 || header.version != kVersion ||
+      file_.size() != kHeaderSize + header.move_entries * sizeof(MoveEntry) +
+                      header.game_entries * sizeof(GameEntry)) {
+    throw InvalidFileException(path);
+  }
+  games_ = header.games;
+  moves_ = reinterpret_cast<const MoveEntry*>(file_.data() + kHeaderSize);
+  number_of_moves_ = header.move_entries;
+  game_entries_ = reinterpret_cast<const GameEntry*>(moves_ + number_of_moves_);
+  number_of_game_entries_ = header.game_entries;
+}
+
+GameDatabase::Entries<GameDatabase::MoveEntry> GameDatabase::findMoves(uint64_t key) const {
+  return findEntries(moves_, number_of_moves_, key);
+}
+
+GameDatabase::Entries<GameDatabase::GameEntry> GameDatabase::findGames(uint64_t key) const {
+  return findEntries(game_entries_, number_of_game_entries_, key);
+}
+
+std::vector<uint32_t> GameDatabase::getResults(uint64_t key) const {
+  std::vector<uint32_t> results(static_cast<size_t>(Result::LAST), 0);
+  for (const MoveEntry& entry: findMoves(key)) {
+    for (size_t i = 0; i < results.size(); ++i) {
+      results[i] += entry.results[i];
+    }
+  }
+  return results;
+}
+
+std::vector<GameDatabase::MoveStatistics> GameDatabase::getMoveStatistics(const Board& board) const {
+  auto getGames = [](const MoveEntry* entry) {
+    uint64_t games = 0;
+    for (uint32_t result: entry->results) {
+      games += result;
+    }
+    return games;
+  };
+  std::vector<const MoveEntry*> entries;
+  for (const MoveEntry& entry: findMoves(zobrist::hash(board))) {
+    if (entry.move != 0) {
+      entries.push_back(&entry);
+    }
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [&getGames](const MoveEntry* first, const MoveEntry* second) {
+                     return getGames(first) > getGames(second);
+                   });
+  std::vector<MoveStatistics> statistics;
+  if (entries.empty()) {
+    return statistics;
+  }
+  MoveCalculator calculator(board);
+  const std::vector<Move> moves = calculator.calculateAllMoves();
+  for (const MoveEntry* entry: entries) {
+    // Entries matching no legal move come from hash collisions.
+    auto move = std::find_if(moves.begin(), moves.end(), [entry](const Move& move) {
+      return OpeningBook::encodeMove(move) == entry->move;
+    });
+    if (move != moves.end()) {
+      statistics.push_back(MoveStatistics{*move, {}});
+      std::copy(std::begin(entry->results), std::end(entry->results),
+                std::begin(statistics.back().results));
+    }
+  }
+  return statistics;
+}
+
+GameDatabase::Result GameDatabase::getResult(const std::string& result) {
+  if (result == "1-0") {
+    return Result::WHITE_WINS;
+  } else if (result == "1/2-1/2") {
+    return Result::DRAW;
+  } else if (result == "0-1") {
+    return Result::BLACK_WINS;
+  }
+  return Result::UNKNOWN;
+}
+
+GameDatabaseBuilder::GameDatabaseBuilder(const std::string& path, size_t run_entries)
+  : path_(path), run_entries_(std::max<size_t>(run_entries, 1)) {
+}
+
+GameDatabaseBuilder::~GameDatabaseBuilder() {
+  for (size_t run = 0; run < move_runs_; ++run) {
+    std::remove(getRunPath("moves", run).c_str());
+  }
+  for (size_t run = 0; run < game_runs_; ++run) {
+    std::remove(getRunPath("games", run).c_str());
+  }
+}
+
+std::string GameDatabaseBuilder::getRunPath(const char* kind, size_t run) const {
+  return path_ + "." + kind + "." + std::to_string(run);
+}
+
+void GameDatabaseBuilder::addGame(uint64_t offset, GameDatabase::Result result,
+                                  const std::vector<Position>& positions) {
+  std::vector<uint64_t> keys;
+  keys.reserve(positions.size());
+  for (const Position& position: positions) {
+    keys.push_back(position.key);
+  }
+  // Repeated positions are reached by the game only once.
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++games_;
+  for (const Position& position: positions) {
+    GameDatabase::MoveEntry entry{position.key, position.move, {}, {}};
+    entry.results[static_cast<size_t>(result)] = 1;
+    moves_.push_back(entry);
+    if (moves_.size() >= run_entries_) {
+      spillMoves();
+    }
+  }
+  for (uint64_t key: keys) {
+    game_entries_.push_back({key, (offset << 2) | static_cast<uint64_t>(result)});
+    if (game_entries_.size() >= run_entries_) {
+      spillGames();
+    }
+  }
+}
+
+void GameDatabaseBuilder::spillMoves() {
+  sortAndCombine(moves_);
+  // Combined entries may leave enough room to continue in memory.
+  if (moves_.size() < run_entries_ / 2) {
+    return;
+  }
+  const std::string path = getRunPath("moves", move_runs_++);
+  std::ofstream run(path, std::ios::binary | std::ios::trunc);
+  writeEntries(run, moves_);
+  if (!run) {
+    throw WriteFailedException(path);
+  }
+  moves_.clear();
+}
+
+void GameDatabaseBuilder::spillGames() {
+  sortAndCombine(game_entries_);
+  const std::string path = getRunPath("games", game_runs_++);
+  std::ofstream run(path, std::ios::binary | std::ios::trunc);
+  writeEntries(run, game_entries_);
+  if (!run) {
+    throw WriteFailedException(path);
+  }
+  game_entries_.clear();
+}
+
+size_t GameDatabaseBuilder::importPgn(const std::string& pgn_path, unsigned threads) {
+  PgnReader reader(pgn_path);
+  // Callbacks of one game come from one thread.
+  auto getPositions = []() -> std::vector<Position>& {
+    thread_local std::vector<Position> game_positions;
+    return game_positions;
+  };
+  return reader.read(
+      [&](const PgnReader::Game&, const Board& board, const Move* move, size_t) {
+        std::vector<Position>& game_positions = getPositions();
+        if (move == nullptr) {
+          game_positions.clear();
+        } else {
+          game_positions.back().move = OpeningBook::encodeMove(*move);
+        }
+        game_positions.push_back({zobrist::hash(board), 0});
+      },
+      [&](const PgnReader::Game& game) {
+        addGame(game.offset, GameDatabase::getResult(game.result), getPositions());
+        getPositions().clear();
+      },
+      threads);
+}
+
+void GameDatabaseBuilder::finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sortAndCombine(moves_);
+  sortAndCombine(game_entries_);
+  std::vector<std::string> move_runs;
+  for (size_t run = 0; run < move_runs_; ++run) {
+    move_runs.push_back(getRunPath("moves", run));
+  }
+  std::vector<std::string> game_runs;
+  for (size_t run = 0; run < game_runs_; ++run) {
+    game_runs.push_back(getRunPath("games", run));
+  }
+
+  std::ofstream output(path_, std::ios::binary | std::ios::trunc);
+  Header header{};
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  header.move_entries = mergeRuns(move_runs, moves_, output);
+  header.game_entries = mergeRuns(game_runs, game_entries_, output);
+  memcpy(header.magic, GameDatabase::kMagic, 4);
+  header.version = kVersion;
+  header.games = games_;
+  output.seekp(0);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.flush();
+  if (!output) {
+    throw WriteFailedException(path_);
+  }
+  moves_.clear();
+  game_entries_.clear();
+}
@@ -0,0 +1,158 @@
+#ifndef GAME_DATABASE_H
+#define GAME_DATABASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MoveCalculator.h"
+
+// Positions of imported games. Keys come from zobrist::hash() and moves
+// are encoded by OpeningBook::encodeMove().
+//
+// File layout (host byte order): magic "CKGD", version byte, three zero
+// bytes, uint64 number of games, uint64 number of move entries, uint64
+// number of game entries, then MoveEntry records sorted by (key, move)
+// and GameEntry records sorted by (key, game).
+class GameDatabase {
+ public:
+  struct InvalidFileException {
+    InvalidFileException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  enum class Result : uint8_t {
+    WHITE_WINS,
+    DRAW,
+    BLACK_WINS,
+    UNKNOWN,
+    LAST
+  };
+
+  // Games which played |move| in position |key|.
+  struct MoveEntry {
+    uint64_t key;
+    // 0 for games which ended in the position.
+    uint16_t move;
+    uint16_t reserved[3];
+    uint32_t results[static_cast<size_t>(Result::LAST)];
+  };
+
+  // One entry for each game which reached position |key|.
+  struct GameEntry {
+    uint64_t key;
+    // Byte offset of the game in the PGN file shifted by 2, ored with Result.
+    uint64_t game;
+
+    uint64_t getOffset() const {
+      return game >> 2;
+    }
+
+    Result getResult() const {
+      return static_cast<Result>(game & 0x3);
+    }
+  };
+
+  template <typename Entry>
+  struct Entries {
+    const Entry* begin() const {
+      return first;
+    }
+
+    const Entry* end() const {
+      return last;
+    }
+
+    size_t size() const {
+      return last - first;
+    }
+
+    const Entry* first;
+    const Entry* last;
+  };
+
+  struct MoveStatistics {
+    Move move;
+    uint32_t results[static_cast<size_t>(Result::LAST)];
+  };
+
+  static constexpr size_t kHeaderSize = 32;
+  static constexpr char kMagic[] = "CKGD";
+
+  // Maps the file, nothing is loaded.
+  GameDatabase(const std::string& path);
+
+  size_t getNumberOfGames() const {
+    return games_;
+  }
+
+  Entries<MoveEntry> findMoves(uint64_t key) const;
+  Entries<GameEntry> findGames(uint64_t key) const;
+
+  // Results of all games which reached |key|, indexed by Result.
+  std::vector<uint32_t> getResults(uint64_t key) const;
+
+  // Legal moves played in |board|, the most frequent first.
+  std::vector<MoveStatistics> getMoveStatistics(const Board& board) const;
+
+  static Result getResult(const std::string& result);
+
+ private:
+  MappedFile file_;
+  size_t games_{0};
+  const MoveEntry* moves_{nullptr};
+  size_t number_of_moves_{0};
+  const GameEntry* game_entries_{nullptr};
+  size_t number_of_game_entries_{0};
+};
+
+// Writes a GameDatabase. Entries are collected in runs of |run_entries|,
+// which are sorted and spilled next to the output file, and merged by finish().
+class GameDatabaseBuilder {
+ public:
+  struct WriteFailedException {
+    WriteFailedException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  struct Position {
+    uint64_t key;
+    // Move played in the position, 0 for the last one.
+    uint16_t move;
+  };
+
+  static constexpr size_t kDefaultRunEntries = 1u << 21;
+
+  GameDatabaseBuilder(const std::string& path, size_t run_entries = kDefaultRunEntries);
+  // Removes spilled runs.
+  ~GameDatabaseBuilder();
+
+  GameDatabaseBuilder(const GameDatabaseBuilder&) = delete;
+  GameDatabaseBuilder& operator=(const GameDatabaseBuilder&) = delete;
+
+  // May be called from several threads.
+  void addGame(uint64_t offset, GameDatabase::Result result, const std::vector<Position>& positions);
+  // Replays all games of |pgn_path| with |threads| threads. Returns number of games.
+  size_t importPgn(const std::string& pgn_path, unsigned threads);
+  // Writes the database; no games may be added afterwards.
+  void finish();
+
+ private:
+  void spillMoves();
+  void spillGames();
+  std::string getRunPath(const char* kind, size_t run) const;
+
+  const std::string path_;
+  const size_t run_entries_;
+  std::mutex mutex_;
+  size_t games_{0};
+  std::vector<GameDatabase::MoveEntry> moves_;
+  std::vector<GameDatabase::GameEntry> game_entries_;
+  size_t move_runs_{0};
+  size_t game_runs_{0};
+};
+
+#endif  // GAME_DATABASE_H
@@ -0,0 +1,96 @@
+/* Component tests for classes GameDatabase and GameDatabaseBuilder */
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "GameDatabase.h"
+#include "Zobrist.h"
+#include "utils/Test.h"
+
+namespace {
+
+const char kInitialFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const std::string kPgnPath = "/tmp/game_database_tests.pgn";
+const std::string kPath = "/tmp/game_database_tests.gdb";
+
+// Both Nf3 games repeat their starting position.
+const std::string kGames =
+    "[Event \"A\"]\n\n1. e4 e5 2. Nf3 Nc6 1-0\n\n"
+    "[Event \"B\"]\n\n1. e4 c5 0-1\n\n"
+    "[Event \"C\"]\n\n1. Nf3 Nf6 2. Ng1 Ng8 3. d4 1/2-1/2\n\n"
+    "[Event \"D\"]\n\n1. Nf3 Nf6 2. Ng1 Ng8 *\n";
+
+std::string readFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void buildDatabase(size_t run_entries, unsigned threads) {
+  std::ofstream(kPgnPath, std::ios::binary | std::ios::trunc) << kGames;
+  GameDatabaseBuilder builder(kPath, run_entries);
+  builder.importPgn(kPgnPath, threads);
+  builder.finish();
+}
+
+TEST_PROCEDURE(GameDatabase_finds_games_and_moves) {
+  TEST_START
+  buildDatabase(GameDatabaseBuilder::kDefaultRunEntries, 1);
+  GameDatabase database(kPath);
+  VERIFY_EQUALS(database.getNumberOfGames(), 4u);
+
+  const Board initial(kInitialFen);
+  const uint64_t key = zobrist::hash(initial);
+  auto games = database.findGames(key);
+  VERIFY_EQUALS(games.size(), 4u);
+  VERIFY_EQUALS(games.begin()->getOffset(), 0u);
+  VERIFY_TRUE(games.begin()->getResult() == GameDatabase::Result::WHITE_WINS);
+  const std::vector<uint32_t> results = database.getResults(key);
+  // Games C and D pass the starting position twice.
+  VERIFY_EQUALS(results[static_cast<size_t>(GameDatabase::Result::WHITE_WINS)], 1u);
+  VERIFY_EQUALS(results[static_cast<size_t>(GameDatabase::Result::BLACK_WINS)], 1u);
+  VERIFY_EQUALS(results[static_cast<size_t>(GameDatabase::Result::DRAW)], 2u);
+  VERIFY_EQUALS(results[static_cast<size_t>(GameDatabase::Result::UNKNOWN)], 2u);
+
+  const auto statistics = database.getMoveStatistics(initial);
+  VERIFY_EQUALS(statistics.size(), 3u);
+  // Nf3 and e4 were played twice, ties keep order of encoded moves.
+  VERIFY_TRUE(statistics[0].move.old_square == Square("g1"));
+  VERIFY_TRUE(statistics[1].move.new_square == Square("e4"));
+  VERIFY_EQUALS(statistics[1].results[static_cast<size_t>(GameDatabase::Result::BLACK_WINS)], 1u);
+  VERIFY_TRUE(statistics[2].move.new_square == Square("d4"));
+
+  const Board sicilian("rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2");
+  VERIFY_EQUALS(database.findGames(zobrist::hash(sicilian)).size(), 1u);
+  VERIFY_EQUALS(database.getMoveStatistics(sicilian).size(), 0u);
+  VERIFY_EQUALS(database.findMoves(zobrist::hash(sicilian)).size(), 1u);
+  VERIFY_EQUALS(database.findGames(zobrist::hash(Board("8/8/8/8/8/8/8/k6K w - - 0 1"))).size(), 0u);
+  TEST_END
+}
+
+TEST_PROCEDURE(GameDatabase_merges_spilled_runs) {
+  TEST_START
+  buildDatabase(GameDatabaseBuilder::kDefaultRunEntries, 1);
+  const std::string in_memory = readFile(kPath);
+  buildDatabase(3, 4);
+  VERIFY_TRUE(readFile(kPath) == in_memory);
+  // Runs are removed.
+  VERIFY_FALSE(std::ifstream(kPath + ".moves.0").good());
+  VERIFY_FALSE(std::ifstream(kPath + ".games.0").good());
+
+  std::ofstream(kPath, std::ios::app) << "x";
+  bool exception_was_thrown = false;
+  try {
+    GameDatabase database(kPath);
+  } catch (GameDatabase::InvalidFileException& e) {
+    exception_was_thrown = e.path == kPath;
+  }
+  VERIFY_TRUE(exception_was_thrown);
+  std::remove(kPath.c_str());
+  std::remove(kPgnPath.c_str());
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -0,0 +1,34 @@
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Bitbase.h"
+#include "BitbaseGenerator.h"
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <output directory> <material>..." << std::endl;
+    std::cerr << "Example: " << argv[0] << " bitbases KQK KRK KPK" << std::endl;
+    return 1;
+  }
+  const std::string output_directory = argv[1];
+  BitbaseGenerator generator(std::thread::hardware_concurrency());
+  try {
+    for (int i = 2; i < argc; ++i) {
+      std::cerr << "Generating " << argv[i] << std::endl;
+      generator.generate(argv[i]);
+    }
+    for (const auto& table: generator.getTables()) {
+      const std::string path = output_directory + "/" + table.first + ".bb";
+      Bitbase::write(path, table.first, table.second);
+      std::cerr << "Written " << path << std::endl;
+    }
+  } catch (Bitbase::InvalidMaterialException& e) {
+    std::cerr << "Invalid material " << e.material << std::endl;
+    return 1;
+  } catch (Bitbase::InvalidBitbaseException& e) {
+    std::cerr << "Cannot write " << e.path << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,151 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+// Counters and cycle timers for hot paths of move generation and search.
+// Compiled in only with -D_INSTRUMENTATION_ON_, otherwise the macros expand
+// to nothing. Data is kept per thread, so instrumented code needs no locking.
+
+#ifdef _INSTRUMENTATION_ON_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace instrumentation {
+
+enum class Counter {
+  KING_IN_CHECK_EXCEPTIONS,
+  NESTED_MOVE_CALCULATORS,
+  IS_CHECK_CALLS,
+  CALCULATE_ALL_MOVES_CALLS,
+  LEGAL_MOVES,
+  EXPANDED_NODES,
+  EVALUATED_MOVES,
+  LAST
+};
+
+enum class Timer {
+  CALCULATE_ALL_MOVES,
+  IS_CHECK,
+  NODE_EXPANSION,
+  LAST
+};
+
+inline const char* toString(Counter counter) {
+  switch (counter) {
+    case Counter::KING_IN_CHECK_EXCEPTIONS:
+      return "king_in_check_exceptions";
+    case Counter::NESTED_MOVE_CALCULATORS:
+      return "nested_move_calculators";
+    case Counter::IS_CHECK_CALLS:
+      return "is_check_calls";
+    case Counter::CALCULATE_ALL_MOVES_CALLS:
+      return "calculate_all_moves_calls";
+    case Counter::LEGAL_MOVES:
+      return "legal_moves";
+    case Counter::EXPANDED_NODES:
+      return "expanded_nodes";
+    case Counter::EVALUATED_MOVES:
+      return "evaluated_moves";
+    case Counter::LAST:
+      break;
+  }
+  return "unknown";
+}
+
+inline const char* toString(Timer timer) {
+  switch (timer) {
+    case Timer::CALCULATE_ALL_MOVES:
+      return "calculate_all_moves";
+    case Timer::IS_CHECK:
+      return "is_check";
+    case Timer::NODE_EXPANSION:
+      return "node_expansion";
+    case Timer::LAST:
+      break;
+  }
+  return "unknown";
+}
+
+inline uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+struct ThreadData {
+  std::array<uint64_t, static_cast<size_t>(Counter::LAST)> counters{};
+  std::array<uint64_t, static_cast<size_t>(Timer::LAST)> cycles{};
+  std::array<uint64_t, static_cast<size_t>(Timer::LAST)> timer_calls{};
+  // Recursive scopes of the same timer are measured only at the outermost level.
+  std::array<unsigned, static_cast<size_t>(Timer::LAST)> nesting{};
+};
+
+inline thread_local ThreadData thread_data;
+
+inline void add(Counter counter, uint64_t value) {
+  thread_data.counters[static_cast<size_t>(counter)] += value;
+}
+
+class ScopedTimer {
+ public:
+  ScopedTimer(Timer timer) : index_(static_cast<size_t>(timer)) {
+    if (thread_data.nesting[index_]++ == 0) {
+      start_ = readCycles();
+    }
+  }
+
+  ~ScopedTimer() {
+    if (--thread_data.nesting[index_] == 0) {
+      thread_data.cycles[index_] += readCycles() - start_;
+      ++thread_data.timer_calls[index_];
+    }
+  }
+
+ private:
+  const size_t index_;
+  uint64_t start_{0};
+};
+
+// Writes data collected by the calling thread since the last dump and resets it.
+inline void dump(std::ostream& ostr, const char* title) {
+  ostr << "instrumentation " << title << ":" << std::endl;
+  for (size_t i = 0; i < thread_data.counters.size(); ++i) {
+    ostr << "  " << toString(static_cast<Counter>(i)) << " " << thread_data.counters[i] << std::endl;
+  }
+  for (size_t i = 0; i < thread_data.cycles.size(); ++i) {
+    const uint64_t calls = thread_data.timer_calls[i];
+    ostr << "  " << toString(static_cast<Timer>(i)) << " cycles " << thread_data.cycles[i]
+         << " calls " << calls
+         << " cycles/call " << (calls > 0 ? thread_data.cycles[i] / calls : 0) << std::endl;
+  }
+  thread_data.counters.fill(0);
+  thread_data.cycles.fill(0);
+  thread_data.timer_calls.fill(0);
+}
+
+}  // namespace instrumentation
+
+#define INSTRUMENT_COUNT(_counter_)\
+  instrumentation::add(instrumentation::Counter::_counter_, 1)
+#define INSTRUMENT_ADD(_counter_, _value_)\
+  instrumentation::add(instrumentation::Counter::_counter_, (_value_))
+#define INSTRUMENT_SCOPE(_timer_)\
+  instrumentation::ScopedTimer instrumentation_timer_##_timer_(instrumentation::Timer::_timer_)
+#define INSTRUMENT_DUMP(_ostr_, _title_) instrumentation::dump((_ostr_), (_title_))
+
+#else
+#define INSTRUMENT_COUNT(_counter_)
+#define INSTRUMENT_ADD(_counter_, _value_)
+#define INSTRUMENT_SCOPE(_timer_)
+#define INSTRUMENT_DUMP(_ostr_, _title_)
+#endif  // _INSTRUMENTATION_ON_
+
+#endif  // INSTRUMENTATION_H
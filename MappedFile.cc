@@ -0,0 +1,42 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw MappingFailedException(path);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    throw MappingFailedException(path);
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0) {
+    void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+      close(fd);
+      throw MappingFailedException(path);
+    }
+    data_ = static_cast<const unsigned char*>(address);
+  }
+  // Mapping stays valid after the descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<unsigned char*>(data_), size_);
+  }
+}
+
+void MappedFile::adviseSequentialAccess() const {
+  if (data_) {
+    madvise(const_cast<unsigned char*>(data_), size_, MADV_SEQUENTIAL);
+  }
+}
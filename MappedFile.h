@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  struct MappingFailedException {
+    MappingFailedException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const unsigned char* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  // Hints the kernel that the file will be read from start to end.
+  void adviseSequentialAccess() const;
+
+ private:
+  const unsigned char* data_{nullptr};
+  size_t size_{0};
+};
+
+#endif  // MAPPED_FILE_H
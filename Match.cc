@@ -0,0 +1,509 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Engine.h"
+#include "MoveCalculator.h"
+#include "OpeningBook.h"
+#include "PositionHistory.h"
+
+namespace {
+
+constexpr char kInitialFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+constexpr int kMateScore = 100000;
+
+struct EngineSettings {
+  unsigned depth{6};
+  unsigned time_for_move_ms{1000};
+  // Material evaluation is used if empty.
+  std::string network_path;
+};
+
+struct MatchSettings {
+  unsigned games{100};
+  unsigned threads{std::max(std::thread::hardware_concurrency(), 1u)};
+  EngineSettings engines[2];
+  std::vector<std::string> openings{kInitialFen};
+  std::string pgn_path;
+  std::string book_path;
+  // Adjudication. Scores are in centipawns, 0 disables the rule.
+  int resign_score{1000};
+  unsigned resign_moves{4};
+  int draw_score{10};
+  unsigned draw_moves{8};
+  unsigned draw_after_move{40};
+  unsigned max_moves{300};
+  // SPRT of H0: elo = elo0 against H1: elo = elo1.
+  double elo0{0.0};
+  double elo1{5.0};
+  double alpha{0.05};
+  double beta{0.05};
+};
+
+enum class GameResult {
+  WHITE_WON,
+  BLACK_WON,
+  DRAW
+};
+
+const char* toString(GameResult result) {
+  switch (result) {
+    case GameResult::WHITE_WON:
+      return "1-0";
+    case GameResult::BLACK_WON:
+      return "0-1";
+    case GameResult::DRAW:
+      return "1/2-1/2";
+  }
+  return "*";
+}
+
+struct PlayedGame {
+  GameResult result{GameResult::DRAW};
+  std::string termination;
+  std::vector<std::string> moves;
+};
+
+// Plays one game, |engines[0]| is white.
+class GamePlayer {
+ public:
+  GamePlayer(const MatchSettings& settings,
+             const EngineSettings& white,
+             const EngineSettings& black,
+             std::shared_ptr<const OpeningBook> book,
+             std::shared_ptr<const Nnue> white_network,
+             std::shared_ptr<const Nnue> black_network)
+    : settings_(settings) {
+    engines_[0] = std::make_unique<Engine>(white.depth, white.time_for_move_ms);
+    engines_[1] = std::make_unique<Engine>(black.depth, black.time_for_move_ms);
+    engines_[0]->setNetwork(white_network);
+    engines_[1]->setNetwork(black_network);
+    for (auto& engine: engines_) {
+      if (book) {
+        engine->setOpeningBook(book);
+      }
+      engine->setStatsCallback([this](Engine::MoveStats stats) {
+        // Mate scores are mapped above any material score.
+        last_score_ = stats.moves_to_mate == 0 ? stats.score :
+            (stats.moves_to_mate > 0 ? kMateScore : -kMateScore);
+      });
+    }
+  }
+
+  PlayedGame play(const std::string& fen);
+
+ private:
+  bool adjudicate(unsigned move_number, PlayedGame& game);
+
+  const MatchSettings& settings_;
+  std::unique_ptr<Engine> engines_[2];
+  int last_score_{0};
+  unsigned resign_count_[2] = {0, 0};
+  unsigned draw_count_{0};
+};
+
+PlayedGame GamePlayer::play(const std::string& fen) {
+  PlayedGame game;
+  Board board(fen);
+  PositionHistory history;
+  history.push(board);
+  for (unsigned ply = 0; ; ++ply) {
+    const unsigned move_number = ply / 2 + 1;
+    if (settings_.max_moves > 0 && move_number > settings_.max_moves) {
+      game.termination = "max moves";
+      return game;
+    }
+    Engine& engine = *engines_[board.whiteToMove() ? 0 : 1];
+    try {
+      Move move = engine.calculateBestMove(board, history);
+      std::stringstream move_str;
+      move_str << move;
+      game.moves.push_back(move_str.str());
+      board = move.board;
+      history.push(board);
+      if (move.insufficient_material) {
+        game.termination = "insufficient material";
+        return game;
+      }
+      if (history.isDrawByRule(board)) {
+        game.termination = history.isThreefoldRepetition(board) ? "threefold repetition" :
+                                                                  "fifty-move rule";
+        return game;
+      }
+    } catch (Engine::NoValidMoveException&) {
+      if (MoveCalculator(board).isCheck()) {
+        game.result = board.whiteToMove() ? GameResult::BLACK_WON : GameResult::WHITE_WON;
+        game.termination = "checkmate";
+      } else {
+        game.termination = "stalemate";
+      }
+      return game;
+    }
+    if (adjudicate(move_number, game)) {
+      return game;
+    }
+  }
+}
+
+bool GamePlayer::adjudicate(unsigned move_number, PlayedGame& game) {
+  // Resign: both engines agree that one side is lost for some moves.
+  if (settings_.resign_score > 0) {
+    for (size_t side = 0; side < 2; ++side) {
+      const bool side_is_lost = side == 0 ? last_score_ <= -settings_.resign_score :
+                                            last_score_ >= settings_.resign_score;
+      resign_count_[side] = side_is_lost ? resign_count_[side] + 1 : 0;
+      if (resign_count_[side] >= 2 * settings_.resign_moves) {
+        game.result = side == 0 ? GameResult::BLACK_WON : GameResult::WHITE_WON;
+        game.termination = "adjudication";
+        return true;
+      }
+    }
+  }
+  // Draw: score stays close to zero for some moves late in the game.
+  if (settings_.draw_score > 0 && move_number >= settings_.draw_after_move) {
+    draw_count_ = std::abs(last_score_) <= settings_.draw_score ? draw_count_ + 1 : 0;
+    if (draw_count_ >= 2 * settings_.draw_moves) {
+      game.termination = "adjudication";
+      return true;
+    }
+  }
+  return false;
+}
+
+class MatchStatistics {
+ public:
+  MatchStatistics(const MatchSettings& settings) : settings_(settings) {}
+
+  // |result| as seen by the first engine.
+  void addResult(double result);
+  bool isSprtFinished() const;
+  void print(std::ostream& ostr) const;
+
+ private:
+  double calculateLLR() const;
+
+  const MatchSettings& settings_;
+  unsigned wins_{0};
+  unsigned losses_{0};
+  unsigned draws_{0};
+};
+
+void MatchStatistics::addResult(double result) {
+  if (result > 0.75) {
+    ++wins_;
+  } else if (result < 0.25) {
+    ++losses_;
+  } else {
+    ++draws_;
+  }
+}
+
+double scoreFromElo(double elo) {
+  return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+double eloFromScore(double score) {
+  return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+// Generalized SPRT with the trinomial model (normal approximation).
+double MatchStatistics::calculateLLR() const {
+  const double games = wins_ + losses_ + draws_;
+  if (games == 0 || wins_ == 0 || losses_ == 0) {
+    return 0.0;
+  }
+  const double score = (wins_ + 0.5 * draws_) / games;
+  const double variance = (wins_ * std::pow(1.0 - score, 2) +
+                           draws_ * std::pow(0.5 - score, 2) +
+                           losses_ * std::pow(score, 2)) / games;
+  const double s0 = scoreFromElo(settings_.elo0);
+  const double s1 = scoreFromElo(settings_.elo1);
+  return games * (s1 - s0) * (2.0 * score - s0 - s1) / (2.0 * variance);
+}
+
+bool MatchStatistics::isSprtFinished() const {
+  const double llr = calculateLLR();
+  return llr <= std::log(settings_.beta / (1.0 - settings_.alpha)) ||
+         llr >= std::log((1.0 - settings_.beta) / settings_.alpha);
+}
+
+void MatchStatistics::print(std::ostream& ostr) const {
+  const unsigned games = wins_ + losses_ + draws_;
+  ostr << "Games " << games << ": +" << wins_ << " -" << losses_ << " =" << draws_;
+  if (games > 0 && wins_ > 0 && losses_ > 0) {
+    const double score = (wins_ + 0.5 * draws_) / games;
+    const double deviation = std::sqrt((wins_ * std::pow(1.0 - score, 2) +
+                                        draws_ * std::pow(0.5 - score, 2) +
+                                        losses_ * std::pow(score, 2)) / games / games);
+    const double elo = eloFromScore(score);
+    const double margin = (eloFromScore(std::min(score + 1.96 * deviation, 0.999)) -
+                           eloFromScore(std::max(score - 1.96 * deviation, 0.001))) / 2.0;
+    ostr << std::fixed << std::setprecision(1) << "  Elo " << elo << " +/- " << margin;
+  }
+  ostr << std::fixed << std::setprecision(2)
+       << "  LLR " << calculateLLR()
+       << " [" << std::log(settings_.beta / (1.0 - settings_.alpha))
+       << ", " << std::log((1.0 - settings_.beta) / settings_.alpha) << "]"
+       << std::defaultfloat << std::endl;
+}
+
+void writePGN(std::ostream& ostr, unsigned round, const std::string& fen,
+              bool first_engine_is_white, const PlayedGame& game) {
+  ostr << "[Event \"chess2.0 match\"]" << std::endl;
+  ostr << "[Round \"" << round << "\"]" << std::endl;
+  ostr << "[White \"" << (first_engine_is_white ? "engine1" : "engine2") << "\"]" << std::endl;
+  ostr << "[Black \"" << (first_engine_is_white ? "engine2" : "engine1") << "\"]" << std::endl;
+  ostr << "[Result \"" << toString(game.result) << "\"]" << std::endl;
+  if (fen != kInitialFen) {
+    ostr << "[SetUp \"1\"]" << std::endl;
+    ostr << "[FEN \"" << fen << "\"]" << std::endl;
+  }
+  ostr << "[Termination \"" << game.termination << "\"]" << std::endl << std::endl;
+  const bool white_starts = Board(fen).whiteToMove();
+  for (size_t i = 0; i < game.moves.size(); ++i) {
+    const size_t ply = white_starts ? i : i + 1;
+    if (ply % 2 == 0) {
+      ostr << ply / 2 + 1 << ". ";
+    } else if (i == 0) {
+      ostr << "1... ";
+    }
+    ostr << game.moves[i] << " ";
+  }
+  ostr << toString(game.result) << std::endl << std::endl;
+}
+
+class Match {
+ public:
+  Match(const MatchSettings& settings, std::ostream& pgn)
+    : settings_(settings), pgn_(pgn), statistics_(settings) {
+    if (!settings.book_path.empty()) {
+      book_ = std::make_shared<OpeningBook>(settings.book_path);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+      if (!settings.engines[i].network_path.empty()) {
+        networks_[i] = std::make_shared<Nnue>(settings.engines[i].network_path);
+      }
+    }
+  }
+
+  void run();
+
+ private:
+  void worker();
+
+  const MatchSettings& settings_;
+  std::ostream& pgn_;
+  std::shared_ptr<const OpeningBook> book_;
+  std::shared_ptr<const Nnue> networks_[2];
+  std::atomic<unsigned> next_game_{0};
+  std::atomic<bool> finished_{false};
+  std::mutex mutex_;
+  MatchStatistics statistics_;
+};
+
+void Match::worker() {
+  while (!finished_) {
+    const unsigned index = next_game_++;
+    if (index >= settings_.games) {
+      return;
+    }
+    // Each opening is played twice, with colors reversed.
+    const std::string& fen = settings_.openings[(index / 2) % settings_.openings.size()];
+    const bool first_engine_is_white = index % 2 == 0;
+    const EngineSettings& white = settings_.engines[first_engine_is_white ? 0 : 1];
+    const EngineSettings& black = settings_.engines[first_engine_is_white ? 1 : 0];
+    GamePlayer player(settings_, white, black, book_,
+                      networks_[first_engine_is_white ? 0 : 1],
+                      networks_[first_engine_is_white ? 1 : 0]);
+    const PlayedGame game = player.play(fen);
+
+    double result = 0.5;
+    if (game.result != GameResult::DRAW) {
+      result = (game.result == GameResult::WHITE_WON) == first_engine_is_white ? 1.0 : 0.0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    writePGN(pgn_, index + 1, fen, first_engine_is_white, game);
+    pgn_.flush();
+    statistics_.addResult(result);
+    statistics_.print(std::cerr);
+    if (statistics_.isSprtFinished()) {
+      std::cerr << "SPRT finished" << std::endl;
+      finished_ = true;
+    }
+  }
+}
+
+void Match::run() {
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < settings_.threads; ++i) {
+    threads.emplace_back(&Match::worker, this);
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+}
+
+bool parseEngineSettings(const std::string& value, EngineSettings& settings) {
+  const size_t comma = value.find(',');
+  if (comma == std::string::npos) {
+    return false;
+  }
+  settings.depth = std::stoul(value.substr(0, comma));
+  settings.time_for_move_ms = std::stoul(value.substr(comma + 1));
+  return true;
+}
+
+bool readOpenings(const std::string& path, std::vector<std::string>& openings) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  openings.clear();
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string field;
+    std::string fen;
+    for (int i = 0; i < 4 && fields >> field; ++i) {
+      fen += (i > 0 ? " " : "") + field;
+    }
+    // Move counters are optional, as in EPD.
+    std::string halfmove_clock = "0";
+    std::string fullmove_number = "1";
+    fields >> halfmove_clock >> fullmove_number;
+    openings.push_back(fen + " " + halfmove_clock + " " + fullmove_number);
+    try {
+      MoveCalculator(Board(openings.back())).calculateAllMoves();
+    } catch (MoveCalculator::InvalidPositionException&) {
+      std::cerr << "Invalid opening " << openings.back() << std::endl;
+      return false;
+    }
+  }
+  return !openings.empty();
+}
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [options]" << std::endl
+            << "  --games N             number of games (100)" << std::endl
+            << "  --threads N           games played at once (all cores)" << std::endl
+            << "  --engine1 DEPTH,MS    settings of the first engine (6,1000)" << std::endl
+            << "  --engine2 DEPTH,MS    settings of the second engine (6,1000)" << std::endl
+            << "  --openings FILE       FEN/EPD positions, one per line" << std::endl
+            << "  --book FILE           opening book used by both engines" << std::endl
+            << "  --network1 FILE       network of the first engine (material)" << std::endl
+            << "  --network2 FILE       network of the second engine (material)" << std::endl
+            << "  --pgn FILE            PGN output (stdout)" << std::endl
+            << "  --resign CP,MOVES     resign adjudication (1000,4), 0 disables" << std::endl
+            << "  --draw CP,MOVES,AFTER draw adjudication (10,8,40), 0 disables" << std::endl
+            << "  --max-moves N         game is drawn after N moves (300)" << std::endl
+            << "  --sprt ELO0,ELO1      SPRT hypotheses (0,5)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], MatchSettings& settings) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const std::string value = argv[++i];
+    char separator;
+    std::istringstream values(value);
+    if (option == "--games") {
+      values >> settings.games;
+    } else if (option == "--threads") {
+      values >> settings.threads;
+    } else if (option == "--engine1") {
+      if (!parseEngineSettings(value, settings.engines[0])) {
+        return false;
+      }
+    } else if (option == "--engine2") {
+      if (!parseEngineSettings(value, settings.engines[1])) {
+        return false;
+      }
+    } else if (option == "--openings") {
+      if (!readOpenings(value, settings.openings)) {
+        std::cerr << "Cannot read openings from " << value << std::endl;
+        return false;
+      }
+    } else if (option == "--book") {
+      settings.book_path = value;
+    } else if (option == "--network1") {
+      settings.engines[0].network_path = value;
+    } else if (option == "--network2") {
+      settings.engines[1].network_path = value;
+    } else if (option == "--pgn") {
+      settings.pgn_path = value;
+    } else if (option == "--resign") {
+      values >> settings.resign_score >> separator >> settings.resign_moves;
+    } else if (option == "--draw") {
+      values >> settings.draw_score >> separator >> settings.draw_moves
+             >> separator >> settings.draw_after_move;
+    } else if (option == "--max-moves") {
+      values >> settings.max_moves;
+    } else if (option == "--sprt") {
+      values >> settings.elo0 >> separator >> settings.elo1;
+    } else {
+      return false;
+    }
+    if (!values && option != "--openings" && option != "--book" && option != "--pgn" &&
+        option != "--network1" && option != "--network2") {
+      return false;
+    }
+  }
+  return settings.threads > 0;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  MatchSettings settings;
+  try {
+    if (!parseArguments(argc, argv, settings)) {
+      printUsage(argv[0]);
+      return 1;
+    }
+  } catch (Board::InvalidFENException& e) {
+    std::cerr << "Invalid opening " << e.fen << std::endl;
+    return 1;
+  } catch (std::exception&) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::ofstream pgn_file;
+  if (!settings.pgn_path.empty()) {
+    pgn_file.open(settings.pgn_path);
+    if (!pgn_file) {
+      std::cerr << "Cannot open " << settings.pgn_path << std::endl;
+      return 1;
+    }
+  }
+  try {
+    Match match(settings, settings.pgn_path.empty() ? std::cout : pgn_file);
+    match.run();
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+    return 1;
+  } catch (OpeningBook::InvalidBookException& e) {
+    std::cerr << "Invalid opening book " << e.path << std::endl;
+    return 1;
+  } catch (Nnue::InvalidNetworkException& e) {
+    std::cerr << "Invalid network " << e.path << std::endl;
+    return 1;
+  }
+  return 0;
+}
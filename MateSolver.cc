@@ -0,0 +1,242 @@
+#include "MateSolver.h"
+
+#include <algorithm>
+
+#include "Zobrist.h"
+
+
+namespace {
+
+constexpr uint32_t kInfinity = 0x0FFFFFFFu;
+constexpr uint64_t kRemainingMovesSalt = 0x9E3779B97F4A7C15ull;
+constexpr uint64_t kAndNodeSalt = 0xD6E8FEB86659FD93ull;
+constexpr unsigned long long kNodesBetweenTimeChecks = 1024ull;
+constexpr uint64_t kEpsilonDivisor = 4;  // epsilon = 1/4
+
+uint32_t clampToInfinity(uint64_t value) {
+  return static_cast<uint32_t>(std::min<uint64_t>(value, kInfinity));
+}
+
+}  // unnamed namespace
+
+
+MateSolver::MateSolver(size_t table_size_mb) {
+  size_t number_of_entries = table_size_mb * 1024 * 1024 / sizeof(Entry);
+  number_of_entries = std::max(number_of_entries - number_of_entries % kBucketSize, kBucketSize);
+  table_.resize(number_of_entries);
+}
+
+uint64_t MateSolver::calculateKey(const Board& board, unsigned remaining, bool or_node) const {
+  uint64_t key = zobrist::hash(board) ^ ((remaining + 1) * kRemainingMovesSalt);
+  return or_node ? key : key ^ kAndNodeSalt;
+}
+
+MateSolver::Entry MateSolver::lookup(uint64_t key) const {
+  const size_t bucket = (key % (table_.size() / kBucketSize)) * kBucketSize;
+  for (size_t i = bucket; i < bucket + kBucketSize; ++i) {
+    if (table_[i].key == key) {
+      return table_[i];
+    }
+  }
+  Entry entry;
+  entry.key = key;
+  return entry;
+}
+
+void MateSolver::store(const Entry& entry) {
+  const size_t bucket = (entry.key % (table_.size() / kBucketSize)) * kBucketSize;
+  size_t victim = bucket;
+  for (size_t i = bucket; i < bucket + kBucketSize; ++i) {
+    if (table_[i].key == entry.key) {
+      victim = i;
+      break;
+    }
+    if (table_[i].work < table_[victim].work) {
+      victim = i;
+    }
+  }
+  table_[victim] = entry;
+}
+
+bool MateSolver::isTimeOut() {
+  if (!time_out_ && nodes_searched_ % kNodesBetweenTimeChecks == 0) {
+    time_out_ = std::chrono::steady_clock::now() >= deadline_;
+  }
+  return time_out_;
+}
+
+bool MateSolver::evaluateTerminal(const Board& board,
+                                  unsigned remaining,
+                                  bool or_node,
+                                  std::vector<Move>& moves,
+                                  Entry& entry) const {
+  auto setResult = [&entry, or_node](bool proven) {
+    // phi is proof number in OR nodes and disproof number in AND nodes.
+    const bool phi_is_zero = proven == or_node;
+    entry.phi = phi_is_zero ? 0 : kInfinity;
+    entry.delta = phi_is_zero ? kInfinity : 0;
+  };
+
+  MoveCalculator calculator(board);
+  try {
+    moves = calculator.calculateAllMoves();
+  } catch (MoveCalculator::InvalidPositionException&) {
+    setResult(false);
+    return true;
+  }
+  if (or_node) {
+    // Attacker cannot mate after a move which leaves insufficient material.
+    std::vector<Move> mating_candidates;
+    for (const Move& move: moves) {
+      if (!move.insufficient_material) {
+        mating_candidates.push_back(move);
+      }
+    }
+    moves.swap(mating_candidates);
+    if (remaining == 0 || moves.empty()) {
+      setResult(false);
+      return true;
+    }
+  } else if (moves.empty()) {
+    setResult(calculator.isCheck());
+    return true;
+  } else if (remaining == 0) {
+    setResult(false);
+    return true;
+  }
+  return false;
+}
+
+void MateSolver::mid(const Board& board, unsigned remaining, bool or_node,
+                     uint32_t phi_threshold, uint32_t delta_threshold) {
+  ++nodes_searched_;
+  const uint64_t key = calculateKey(board, remaining, or_node);
+  Entry entry = lookup(key);
+  std::vector<Move> moves;
+  if (isTimeOut() || evaluateTerminal(board, remaining, or_node, moves, entry)) {
+    store(entry);
+    return;
+  }
+
+  const unsigned long long nodes_before = nodes_searched_;
+  const unsigned child_remaining = or_node ? remaining - 1 : remaining;
+  std::vector<uint64_t> child_keys;
+  child_keys.reserve(moves.size());
+  for (const Move& move: moves) {
+    child_keys.push_back(calculateKey(move.board, child_remaining, !or_node));
+  }
+
+  while (true) {
+    // phi(n) = min delta(child), delta(n) = sum phi(child)
+    uint32_t min_delta = kInfinity;
+    uint32_t second_delta = kInfinity;
+    uint32_t best_child_phi = kInfinity;
+    uint64_t sum_phi = 0ull;
+    size_t best_child = 0;
+    for (size_t i = 0; i < child_keys.size(); ++i) {
+      const Entry child = lookup(child_keys[i]);
+      sum_phi += child.phi;
+      if (child.delta < min_delta) {
+        second_delta = min_delta;
+        min_delta = child.delta;
+        best_child = i;
+        best_child_phi = child.phi;
+      } else if (child.delta < second_delta) {
+        second_delta = child.delta;
+      }
+    }
+    entry.phi = min_delta;
+    entry.delta = clampToInfinity(sum_phi);
+    if (entry.phi >= phi_threshold || entry.delta >= delta_threshold || time_out_) {
+      break;
+    }
+    const uint32_t child_phi_threshold =
+        clampToInfinity(static_cast<uint64_t>(delta_threshold) - entry.delta + best_child_phi);
+    // 1+epsilon trick: let the child run a bit past the second best
+    // sibling, otherwise search keeps switching between them.
+    const uint64_t second_delta_with_margin =
+        std::max<uint64_t>(second_delta + 1ull,
+                           second_delta + second_delta / kEpsilonDivisor);
+    const uint32_t child_delta_threshold =
+        std::min(phi_threshold, clampToInfinity(second_delta_with_margin));
+    mid(moves[best_child].board, child_remaining, !or_node,
+        child_phi_threshold, child_delta_threshold);
+  }
+  entry.work = clampToInfinity(nodes_searched_ - nodes_before);
+  store(entry);
+}
+
+bool MateSolver::prove(const Board& board, unsigned remaining, bool or_node) {
+  mid(board, remaining, or_node, kInfinity, kInfinity);
+  const Entry entry = lookup(calculateKey(board, remaining, or_node));
+  return or_node ? entry.phi == 0 : entry.delta == 0;
+}
+
+unsigned MateSolver::findMateDistance(const Board& board, unsigned max_moves, bool or_node) {
+  for (unsigned moves = 1; moves <= max_moves && !time_out_; ++moves) {
+    if (prove(board, moves, or_node)) {
+      return moves;
+    }
+  }
+  return 0;
+}
+
+MateSolver::Solution MateSolver::solve(const Board& board, unsigned max_moves, unsigned time_limit_ms) {
+  nodes_searched_ = 0ull;
+  time_out_ = false;
+  deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_limit_ms);
+
+  Solution solution;
+  solution.moves_to_mate = findMateDistance(board, max_moves, true);
+  if (solution.moves_to_mate == 0) {
+    return solution;
+  }
+  solution.found = true;
+
+  // Attacker plays a move which keeps the mate, defender one which
+  // delays it the most. Table entries left by the proof are tried
+  // first, search is repeated only for the entries which were replaced.
+  Board current = board;
+  unsigned remaining = solution.moves_to_mate;
+  while (remaining > 0 && !time_out_) {
+    std::vector<Move> moves = MoveCalculator(current).calculateAllMoves();
+    auto isProven = [this, remaining](const Move& move) {
+      return !move.insufficient_material &&
+             lookup(calculateKey(move.board, remaining - 1, false)).delta == 0;
+    };
+    auto attacker_move = std::find_if(moves.begin(), moves.end(), isProven);
+    if (attacker_move == moves.end()) {
+      attacker_move = std::find_if(moves.begin(), moves.end(), [this, remaining](const Move& move) {
+        return !move.insufficient_material && prove(move.board, remaining - 1, false);
+      });
+    }
+    if (attacker_move == moves.end()) {
+      break;
+    }
+    solution.line.push_back(*attacker_move);
+    current = attacker_move->board;
+
+    std::vector<Move> replies = MoveCalculator(current).calculateAllMoves();
+    if (replies.empty() || remaining < 2) {
+      break;
+    }
+    // Every reply allows mate in remaining - 1 moves, the longest
+    // defence is a reply after which there is no faster one.
+    auto isDisproven = [this, remaining](const Move& move) {
+      return lookup(calculateKey(move.board, remaining - 2, true)).delta == 0;
+    };
+    auto defender_move = std::find_if(replies.begin(), replies.end(), isDisproven);
+    if (defender_move == replies.end()) {
+      defender_move = std::find_if(replies.begin(), replies.end(), [this, remaining](const Move& move) {
+        return !prove(move.board, remaining - 2, true);
+      });
+    }
+    if (defender_move == replies.end()) {
+      defender_move = replies.begin();
+    }
+    solution.line.push_back(*defender_move);
+    current = defender_move->board;
+    --remaining;
+  }
+  return solution;
+}
@@ -0,0 +1,65 @@
+#ifndef MATE_SOLVER_H
+#define MATE_SOLVER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "MoveCalculator.h"
+
+// Finds forced mates with depth-first proof-number search (df-pn).
+// Side to move is the attacker. Proof and disproof numbers are kept in
+// a transposition table of fixed size; when a bucket is full the entry
+// with the least work behind it is replaced.
+class MateSolver {
+ public:
+  struct Solution {
+    bool found{false};
+    unsigned moves_to_mate{0};  // Number of moves of the attacker.
+    std::vector<Move> line;
+  };
+
+  MateSolver(size_t table_size_mb);
+
+  // Looks for the shortest mate in at most |max_moves| moves. Search is
+  // abandoned after |time_limit_ms|.
+  Solution solve(const Board& board, unsigned max_moves, unsigned time_limit_ms);
+
+  unsigned long long getNodesSearched() const {
+    return nodes_searched_;
+  }
+
+ private:
+  struct Entry {
+    uint64_t key{0ull};
+    uint32_t phi{1};
+    uint32_t delta{1};
+    uint32_t work{0};
+  };
+
+  static constexpr size_t kBucketSize = 4;
+
+  // |remaining| is number of attacker moves left. In OR nodes attacker
+  // is to move, in AND nodes the defender.
+  bool prove(const Board& board, unsigned remaining, bool or_node);
+  void mid(const Board& board, unsigned remaining, bool or_node,
+           uint32_t phi_threshold, uint32_t delta_threshold);
+  bool evaluateTerminal(const Board& board,
+                        unsigned remaining,
+                        bool or_node,
+                        std::vector<Move>& moves,
+                        Entry& entry) const;
+  unsigned findMateDistance(const Board& board, unsigned max_moves, bool or_node);
+
+  uint64_t calculateKey(const Board& board, unsigned remaining, bool or_node) const;
+  Entry lookup(uint64_t key) const;
+  void store(const Entry& entry);
+  bool isTimeOut();
+
+  std::vector<Entry> table_;
+  unsigned long long nodes_searched_{0ull};
+  std::chrono::steady_clock::time_point deadline_;
+  bool time_out_{false};
+};
+
+#endif  // MATE_SOLVER_H
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Engine.h"
+#include "MoveCalculator.h"
+#include "Nnue.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned kDefaultSamples = 200;
+// Every sample repeats the benchmarked call for at least this long,
+// so that timer resolution does not distort short calls.
+constexpr auto kMinSampleTime = std::chrono::microseconds(200);
+constexpr auto kWarmUpTime = std::chrono::milliseconds(100);
+
+struct PositionType {
+  const char* name;
+  const char* fen;
+};
+
+const PositionType kPositionTypes[] = {
+  {"opening", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"},
+  {"middlegame", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"},
+  {"endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"},
+  {"promotion", "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"},
+  {"check", "rnbqkbnr/ppp2ppp/3p4/1B2p3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 3"},
+};
+
+struct Summary {
+  std::string name;
+  unsigned long long calls;
+  double median_ns;
+  double p99_ns;
+  double mean_ns;
+  double stddev_ns;
+  double min_ns;
+};
+
+// Keeps results of benchmarked calls alive, so they are not optimized away.
+volatile size_t sink;
+
+class Microbench {
+ public:
+  Microbench(unsigned samples, const std::string& filter)
+    : samples_(samples), filter_(filter) {}
+
+  void run(const std::string& name, const std::function<size_t()>& function);
+  void printJSON(std::ostream& ostr) const;
+
+ private:
+  unsigned calibrate(const std::function<size_t()>& function) const;
+
+  const unsigned samples_;
+  const std::string filter_;
+  std::vector<Summary> summaries_;
+};
+
+// Number of calls in one sample.
+unsigned Microbench::calibrate(const std::function<size_t()>& function) const {
+  unsigned calls = 1;
+  while (true) {
+    auto start = Clock::now();
+    for (unsigned i = 0; i < calls; ++i) {
+      sink = function();
+    }
+    if (Clock::now() - start >= kMinSampleTime) {
+      return calls;
+    }
+    calls *= 2;
+  }
+}
+
+void Microbench::run(const std::string& name, const std::function<size_t()>& function) {
+  if (name.find(filter_) == std::string::npos) {
+    return;
+  }
+  auto warm_up_end = Clock::now() + kWarmUpTime;
+  while (Clock::now() < warm_up_end) {
+    sink = function();
+  }
+  const unsigned calls = calibrate(function);
+
+  std::vector<double> samples;
+  samples.reserve(samples_);
+  for (unsigned sample = 0; sample < samples_; ++sample) {
+    auto start = Clock::now();
+    for (unsigned i = 0; i < calls; ++i) {
+      sink = function();
+    }
+    std::chrono::duration<double, std::nano> duration = Clock::now() - start;
+    samples.push_back(duration.count() / calls);
+  }
+  std::sort(samples.begin(), samples.end());
+
+  double mean = 0.0;
+  for (double sample: samples) {
+    mean += sample;
+  }
+  mean /= samples.size();
+  double variance = 0.0;
+  for (double sample: samples) {
+    variance += (sample - mean) * (sample - mean);
+  }
+  variance /= samples.size() > 1 ? samples.size() - 1 : 1;
+  const size_t middle = samples.size() / 2;
+  const double median = samples.size() % 2 ? samples[middle] :
+                                             (samples[middle - 1] + samples[middle]) / 2.0;
+  const size_t p99 = std::min(samples.size() - 1,
+                              static_cast<size_t>(std::ceil(samples.size() * 0.99)) - 1);
+  summaries_.push_back({name, static_cast<unsigned long long>(calls) * samples_,
+                        median, samples[p99], mean, std::sqrt(variance), samples.front()});
+  std::cerr << name << ": " << median << " ns" << std::endl;
+}
+
+void Microbench::printJSON(std::ostream& ostr) const {
+  ostr << "{\n  \"unit\": \"ns\",\n  \"samples\": " << samples_ << ",\n  \"benchmarks\": [";
+  for (size_t i = 0; i < summaries_.size(); ++i) {
+    const Summary& summary = summaries_[i];
+    ostr << (i > 0 ? "," : "") << "\n    {"
+         << "\"name\": \"" << summary.name << "\", "
+         << "\"calls\": " << summary.calls << ", "
+         << "\"median\": " << summary.median_ns << ", "
+         << "\"p99\": " << summary.p99_ns << ", "
+         << "\"mean\": " << summary.mean_ns << ", "
+         << "\"stddev\": " << summary.stddev_ns << ", "
+         << "\"min\": " << summary.min_ns << "}";
+  }
+  ostr << "\n  ]\n}" << std::endl;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  unsigned samples = kDefaultSamples;
+  std::string filter;
+  std::string network_path;
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option == "--samples" && i + 1 < argc) {
+      samples = std::atoi(argv[++i]);
+    } else if (option == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (option == "--network" && i + 1 < argc) {
+      network_path = argv[++i];
+    } else {
+      samples = 0;
+    }
+    if (samples == 0) {
+      std::cerr << "Usage: " << argv[0] << " [--samples N] [--filter NAME] [--network FILE]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::unique_ptr<Nnue> network;
+  try {
+    if (!network_path.empty()) {
+      network = std::make_unique<Nnue>(network_path);
+    }
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+    return 1;
+  } catch (Nnue::InvalidNetworkException& e) {
+    std::cerr << "Invalid network " << e.path << std::endl;
+    return 1;
+  }
+
+  Microbench bench(samples, filter);
+  for (const PositionType& type: kPositionTypes) {
+    const std::string fen = type.fen;
+    const Board board(fen);
+    const std::string suffix = std::string("/") + type.name;
+
+    bench.run("board_from_fen" + suffix, [&fen]() {
+      return static_cast<size_t>(Board(fen).whiteToMove());
+    });
+    bench.run("board_create_fen" + suffix, [&board]() {
+      return board.createFEN().size();
+    });
+    bench.run("calculate_all_moves" + suffix, [&board]() {
+      return MoveCalculator(board).calculateAllMoves().size();
+    });
+    bench.run("is_check" + suffix, [&board]() {
+      return static_cast<size_t>(MoveCalculator(board).isCheck());
+    });
+    bench.run("evaluate" + suffix, [&board]() {
+      return static_cast<size_t>(Engine::evaluate(board));
+    });
+    if (network) {
+      const Board next_board = MoveCalculator(board).calculateAllMoves().front().board;
+      Nnue::Accumulator accumulator;
+      network->refresh(board, accumulator);
+      bench.run("nnue_refresh" + suffix, [&network, &board]() {
+        Nnue::Accumulator result;
+        network->refresh(board, result);
+        return static_cast<size_t>(result.values[0][0]);
+      });
+      // Incremental update for one move followed by the output layer,
+      // as done for every node of the search.
+      bench.run("nnue_update_and_evaluate" + suffix, [&network, &board, &next_board, &accumulator]() {
+        Nnue::Accumulator result;
+        network->update(accumulator, board, next_board, result);
+        return static_cast<size_t>(network->evaluate(result, next_board.whiteToMove()));
+      });
+    }
+    // Root expansion only: all moves generated and evaluated once.
+    // Includes setting up the engine and its tables.
+    bench.run("search_one_ply" + suffix, [&board]() {
+      Engine engine(1, 1000);
+      engine.setRandomSeed(0);
+      return static_cast<size_t>(engine.calculateBestMove(board).new_square.letter);
+    });
+  }
+  bench.printJSON(std::cout);
+  return 0;
+}
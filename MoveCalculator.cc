@@ -1,5 +1,10 @@
 #include "MoveCalculator.h"
 
+#include <cctype>
+
+#include "BoardScan.h"
+#include "Instrumentation.h"
+
 
 namespace {
 
@@ -16,20 +21,35 @@ bool isFinalRank(size_t row) {
   return row == 0 || row == Board::kBoardSize - 1;
 }
 
-bool isWhite(char figure) {
-  return figure == 'P' || figure == 'K' || figure == 'N' ||
-         figure == 'B' || figure == 'R' || figure == 'Q';
-}
-
-bool isStartingRow(char figure, size_t row) {
-  return (figure == 'P' && row == 1) ||
-         (figure == 'p' && row == Board::kBoardSize - 2);
-}
-
 constexpr size_t kKingStartingLine = 4lu;
 constexpr size_t kQueenSideRookStartingLine = 0lu;
 constexpr size_t kKingSideRookStartingLine = Board::kBoardSize - 1;
 
+// Everything that depends on the color of moving figures.
+template <bool kWhite>
+struct Side {
+  static constexpr char kPawn = kWhite ? 'P' : 'p';
+  static constexpr char kKnight = kWhite ? 'N' : 'n';
+  static constexpr char kBishop = kWhite ? 'B' : 'b';
+  static constexpr char kRook = kWhite ? 'R' : 'r';
+  static constexpr char kQueen = kWhite ? 'Q' : 'q';
+  static constexpr char kKing = kWhite ? 'K' : 'k';
+  static constexpr int kForward = kWhite ? 1 : -1;
+  static constexpr size_t kPawnStartingRow = kWhite ? 1 : Board::kBoardSize - 2;
+  static constexpr size_t kKingStartingRow = kWhite ? 0 : Board::kBoardSize - 1;
+  static constexpr Castling kKingSideCastling = kWhite ? Castling::K : Castling::k;
+  static constexpr Castling kQueenSideCastling = kWhite ? Castling::Q : Castling::q;
+
+  // White figures are upper case letters, black ones lower case.
+  static bool isOwn(char figure) {
+    return kWhite ? figure != 0x0 && figure < 'a' : figure >= 'a';
+  }
+
+  static bool isOpponent(char figure) {
+    return Side<!kWhite>::isOwn(figure);
+  }
+};
+
 }  // unnamed namespace
 
 
@@ -59,53 +79,71 @@ std::ostream& operator<<(std::ostream& ostr, const Move& move) {
   return ostr;
 }
 
+template <bool kWhite>
 void MoveCalculator::calculateAllMovesForFigure(size_t line, size_t row) {
+  using S = Side<kWhite>;
   switch (board_.at(line, row)) {
-    case 'p':
-    case 'P':
-      calculateMovesForPawn(line, row);
+    case S::kPawn:
+      calculateMovesForPawn<kWhite>(line, row);
       break;
-    case 'n':
-    case 'N':
-      calculateMovesForKnight(line, row);
+    case S::kKnight:
+      calculateMovesForKnight<kWhite>(line, row);
       break;
-    case 'b':
-    case 'B':
-      calculateMovesForBishop(line, row);
+    case S::kBishop:
+      calculateMovesForBishop<kWhite>(line, row);
       break;
-    case 'r':
-    case 'R':
-      calculateMovesForRook(line, row);
+    case S::kRook:
+      calculateMovesForRook<kWhite>(line, row);
       break;
-    case 'q':
-    case 'Q':
-      calculateMovesForQueen(line, row);
+    case S::kQueen:
+      calculateMovesForQueen<kWhite>(line, row);
       break;
-    case 'k':
-    case 'K':
-      calculateMovesForKing(line, row);
+    case S::kKing:
+      calculateMovesForKing<kWhite>(line, row);
       break;
   }
 }
 
 std::vector<Move> MoveCalculator::calculateAllMoves() {
-  for (size_t line = 0; line < Board::kBoardSize; ++line) {
-    for (size_t row = 0; row < Board::kBoardSize; ++row) {
-      char square = board_.at(line, row);
-      if (board_.at(line, row) && board_.whiteToMove() == isWhite(square)) {
-        calculateAllMovesForFigure(line, row);
-      }
-    }
+  INSTRUMENT_COUNT(CALCULATE_ALL_MOVES_CALLS);
+  INSTRUMENT_SCOPE(CALCULATE_ALL_MOVES);
+  if (board_.whiteToMove()) {
+    calculateAllMoves<true>();
+  } else {
+    calculateAllMoves<false>();
   }
   return moves_;
 }
 
-bool MoveCalculator::isValidMove(size_t old_line, size_t old_row,
-                                 size_t new_line, size_t new_row) {
-  if (board_.at(new_line, new_row) == 0x0) {
-    return true;
+template <bool kWhite>
+void MoveCalculator::calculateAllMoves() {
+  uint64_t white, black;
+  board_scan::calculateColorMasks(board_, white, black);
+  // Lowest bit first, which keeps the line by line order of generated moves.
+  for (uint64_t figures = kWhite ? white : black; figures; figures &= figures - 1) {
+    const unsigned index = __builtin_ctzll(figures);
+    calculateAllMovesForFigure<kWhite>(board_scan::getLine(index), board_scan::getRow(index));
+  }
+}
+
+std::vector<Move> MoveCalculator::calculateMovesOfFigure(char figure) {
+  if (board_.whiteToMove()) {
+    calculateMovesOfFigure<true>(figure);
+  } else {
+    calculateMovesOfFigure<false>(figure);
+  }
+  return moves_;
+}
+
+template <bool kWhite>
+void MoveCalculator::calculateMovesOfFigure(char figure) {
+  board_scan::Masks masks;
+  board_scan::calculateMasks(board_, masks);
+  for (uint64_t figures = board_scan::getFigureMask(masks, kWhite ? figure : tolower(figure));
+       figures; figures &= figures - 1) {
+    const unsigned index = __builtin_ctzll(figures);
+    calculateAllMovesForFigure<kWhite>(board_scan::getLine(index), board_scan::getRow(index));
   }
-  return isWhite(board_.at(old_line, old_row)) != isWhite(board_.at(new_line, new_row));
 }
 
 void MoveCalculator::resetCastlings(Board& board, char figure, size_t line, size_t row) const {
@@ -135,10 +173,11 @@ void MoveCalculator::resetCastlings(Board& board, char figure, size_t line, size
   }
 }
 
+template <bool kWhite>
 bool MoveCalculator::handlePossibleMove(size_t old_line, size_t old_row,
                                         size_t new_line, size_t new_row) {
   if (isSquareOnBoard(new_line, new_row) == false ||
-      isValidMove(old_line, old_row, new_line, new_row) == false) {
+      Side<kWhite>::isOwn(board_.at(new_line, new_row))) {
     return false;
   }
   Move move(board_, old_line, old_row, new_line, new_row);
@@ -170,6 +209,7 @@ void MoveCalculator::handleMove(Move& move, bool is_king_capture) {
 
   move.board.changeSideToMove();
   try {
+    INSTRUMENT_COUNT(NESTED_MOVE_CALCULATORS);
     MoveCalculator calculator(move.board, true);
     calculator.calculateAllMoves();
     // Exception KingInCheckException was not thrown so move is valid.
@@ -178,11 +218,15 @@ void MoveCalculator::handleMove(Move& move, bool is_king_capture) {
     }
     updateInsufficientMaterialForMove(move);
     moves_.push_back(move);
+    INSTRUMENT_COUNT(LEGAL_MOVES);
   } catch (KingInCheckException& e) {
+    INSTRUMENT_COUNT(KING_IN_CHECK_EXCEPTIONS);
   }
 }
 
 bool MoveCalculator::isCheck() const {
+  INSTRUMENT_COUNT(IS_CHECK_CALLS);
+  INSTRUMENT_SCOPE(IS_CHECK);
   Board copy = board_;
   copy.changeSideToMove();
   MoveCalculator calculator(copy, true);
@@ -190,86 +234,41 @@ bool MoveCalculator::isCheck() const {
   try {
     calculator.calculateAllMoves();
   } catch (KingInCheckException&) {
+    INSTRUMENT_COUNT(KING_IN_CHECK_EXCEPTIONS);
     is_check = true;
   }
   return is_check;
 }
 
 void MoveCalculator::updateInsufficientMaterialForMove(Move& move) const {
-  const Board& board = move.board;
-  bool insufficient_material = true;
-  bool white_has_bishop = false;
-  bool black_has_bishop = false;
-  bool white_has_knight = false;
-  bool black_has_knight = false;
-  for (size_t line = 0; line < Board::kBoardSize; ++line) {
-    for (size_t row = 0; row < Board::kBoardSize; ++row) {
-      char figure = board.at(line, row);
-      if (figure == 0x0) {
-        continue;
-      }
-      switch (figure) {
-        case 'Q':
-        case 'q':
-        case 'R':
-        case 'r':
-        case 'P':
-        case 'p':
-          insufficient_material = false;
-          break;
-        case 'B':
-          if (white_has_bishop || white_has_knight) {
-            insufficient_material = false;
-          } else {
-            white_has_bishop = true;
-          }
-          break;
-        case 'b':
-          if (black_has_bishop || black_has_knight) {
-            insufficient_material = false;
-          } else {
-            black_has_bishop = true;
-          }
-          break;
-        case 'N':
-          if (white_has_bishop) {
-            insufficient_material = false;
-          } else {
-            white_has_knight = true;
-          }
-          break;
-        case 'n':
-          if (black_has_bishop) {
-            insufficient_material = false;
-          } else {
-            black_has_knight = true;
-          }
-          break;
-        default:
-          BoardAssert(board, figure == 'K' || figure == 'k');
-          break;
-      }
-      if (insufficient_material == false) {
-        break;
-      }
-    }
-    if (insufficient_material == false) {
-      break;
-    }
-  }
-  move.insufficient_material = insufficient_material;
+  board_scan::Masks masks;
+  board_scan::calculateMasks(move.board, masks);
+  auto mask = [&masks](char figure) {
+    return board_scan::getFigureMask(masks, figure);
+  };
+  // Either side may have only a single bishop or any number of knights.
+  auto hasInsufficientMaterial = [&mask](char bishop, char knight) {
+    const unsigned bishops = board_scan::count(mask(bishop));
+    return bishops == 0 || (bishops == 1 && mask(knight) == 0ull);
+  };
+  const uint64_t major_pieces_and_pawns = mask('Q') | mask('q') | mask('R') | mask('r') |
+                                          mask('P') | mask('p');
+  move.insufficient_material = major_pieces_and_pawns == 0ull &&
+                               hasInsufficientMaterial('B', 'N') &&
+                               hasInsufficientMaterial('b', 'n');
 }
 
+template <bool kWhite>
 void MoveCalculator::calculateMovesForPawn(size_t line, size_t row) {
-  BoardAssert(board_, board_.at(line, row) == 'p' || board_.at(line, row) == 'P');
-  handlePossiblePawnsCapture(line, row);
+  using S = Side<kWhite>;
+  BoardAssert(board_, board_.at(line, row) == S::kPawn);
+  handlePossiblePawnsCapture<kWhite>(line, row, 1);
+  handlePossiblePawnsCapture<kWhite>(line, row, -1);
   if (look_for_king_capture_) {
     // Pawn move cannot beat king.
     return;
   }
-  bool is_white = isWhite(board_.at(line, row));
-  int forward = is_white ? 1 : -1;
-  size_t forward_row = row + forward;
+  size_t forward_row = row + S::kForward;
   if (isSquareOnBoard(line, forward_row) == false) {
     throw InvalidPositionException("calculateMovesForPawn: pawn on the first/last row");
   }
@@ -277,213 +276,179 @@ void MoveCalculator::calculateMovesForPawn(size_t line, size_t row) {
   auto helper = [this](size_t line, size_t old_row, size_t new_row, Square en_passant) {
     Move move(board_, line, old_row, line, new_row);
     move.board.at(line, old_row) = 0x0;
-    move.board.at(line, new_row) = board_.at(line, old_row);
+    move.board.at(line, new_row) = S::kPawn;
     move.board.resetNumberOfHalfMoves();
     move.board.setEnPassantTargetSquare(en_passant);
     if (isFinalRank(new_row)) {
-      handlePawnPromotion(move, line, new_row);
+      handlePawnPromotion<kWhite>(move, line, new_row);
     } else {
       handleMove(move, false);
     }
   };
 
-  char examined_square = board_.at(line, forward_row);
-  if (examined_square == 0x0) {
+  if (board_.at(line, forward_row) == 0x0) {
     helper(line, row, forward_row, Square::InvalidSquare);
-    if (isStartingRow(board_.at(line, row), row)) {
-      forward_row += forward;
-      examined_square = board_.at(line, forward_row);
-      if (examined_square == 0x0) {
-        Square en_passant(line, row + forward);
+    if (row == S::kPawnStartingRow) {
+      forward_row += S::kForward;
+      if (board_.at(line, forward_row) == 0x0) {
+        Square en_passant(line, row + S::kForward);
         helper(line, row, forward_row, en_passant);
       }
     }
   }
 }
 
-void MoveCalculator::handlePossiblePawnsCapture(size_t line, size_t row) {
-  BoardAssert(board_, board_.at(line, row) == 'p' || board_.at(line, row) == 'P');
-  auto helper = [this, line, row](int shift) {
-    bool is_white = isWhite(board_.at(line, row));
-    size_t forward_row = is_white ? row + 1 : row - 1;
-    if (isSquareOnBoard(line + shift, forward_row)) {
-      Square en_passant_square = board_.getEnPassantTargetSquare();
-      bool is_en_passant_capture = Square(line + shift, forward_row) == en_passant_square;
-      if (is_en_passant_capture ||
-          (board_.at(line + shift, forward_row) &&
-           isWhite(board_.at(line + shift, forward_row)) != is_white)) {
-        Move move(board_, line, row, line + shift, forward_row);
-        move.capture = true;
-        move.board.at(line, row) = 0x0;
-        move.board.at(line + shift, forward_row) = board_.at(line, row);
-        move.board.resetNumberOfHalfMoves();
-        move.board.setEnPassantTargetSquare(Square::InvalidSquare);
-        bool is_king_capture = isKing(board_.at(line + shift, forward_row));
-        if (is_en_passant_capture) {
-          BoardAssert(board_, move.board.at(line + shift, row) == 'P' ||
-                              move.board.at(line + shift, row) == 'p');
-          move.board.at(line + shift, row) = 0x0;
-        }
-        if (!is_king_capture && isFinalRank(forward_row)) {
-          handlePawnPromotion(move, line + shift, forward_row);
-        } else {
-          handleMove(move, is_king_capture);
-        }
-      }
-    }
-  };
-  helper(1);
-  helper(-1);
+template <bool kWhite>
+void MoveCalculator::handlePossiblePawnsCapture(size_t line, size_t row, int shift) {
+  using S = Side<kWhite>;
+  const size_t forward_row = row + S::kForward;
+  if (isSquareOnBoard(line + shift, forward_row) == false) {
+    return;
+  }
+  const char captured = board_.at(line + shift, forward_row);
+  const bool is_en_passant_capture =
+      Square(line + shift, forward_row) == board_.getEnPassantTargetSquare();
+  if (!is_en_passant_capture && !S::isOpponent(captured)) {
+    return;
+  }
+  Move move(board_, line, row, line + shift, forward_row);
+  move.capture = true;
+  move.board.at(line, row) = 0x0;
+  move.board.at(line + shift, forward_row) = S::kPawn;
+  move.board.resetNumberOfHalfMoves();
+  move.board.setEnPassantTargetSquare(Square::InvalidSquare);
+  const bool is_king_capture = isKing(captured);
+  if (is_en_passant_capture) {
+    BoardAssert(board_, move.board.at(line + shift, row) == 'P' ||
+                        move.board.at(line + shift, row) == 'p');
+    move.board.at(line + shift, row) = 0x0;
+  }
+  if (!is_king_capture && isFinalRank(forward_row)) {
+    handlePawnPromotion<kWhite>(move, line + shift, forward_row);
+  } else {
+    handleMove(move, is_king_capture);
+  }
 }
 
+template <bool kWhite>
 void MoveCalculator::handlePawnPromotion(const Move& move, size_t line, size_t row) {
-  assert(move.board.at(line, row) == 'p' || move.board.at(line, row) == 'P');
+  using S = Side<kWhite>;
+  assert(move.board.at(line, row) == S::kPawn);
   assert(isFinalRank(row));
-  auto helper = [this, &move, line, row](char figure) {
+  for (char figure: {S::kQueen, S::kRook, S::kBishop, S::kKnight}) {
     Move copy = move;
     copy.board.at(line, row) = figure;
     copy.promotion = figure;
     handleMove(copy, false);
-  };
-
-  if (move.board.at(line, row) == 'P') {
-    helper('Q');
-    helper('R');
-    helper('B');
-    helper('N');
-  } else {
-    helper('q');
-    helper('r');
-    helper('b');
-    helper('n');
   }
 }
 
+template <bool kWhite>
 void MoveCalculator::calculateMovesForKnight(size_t line, size_t row) {
-  handlePossibleMove(line, row, line + 1, row + 2);
-  handlePossibleMove(line, row, line - 1, row + 2);
-  handlePossibleMove(line, row, line + 2, row + 1);
-  handlePossibleMove(line, row, line + 2, row - 1);
-  handlePossibleMove(line, row, line + 1, row - 2);
-  handlePossibleMove(line, row, line - 1, row - 2);
-  handlePossibleMove(line, row, line - 2, row + 1);
-  handlePossibleMove(line, row, line - 2, row - 1);
+  handlePossibleMove<kWhite>(line, row, line + 1, row + 2);
+  handlePossibleMove<kWhite>(line, row, line - 1, row + 2);
+  handlePossibleMove<kWhite>(line, row, line + 2, row + 1);
+  handlePossibleMove<kWhite>(line, row, line + 2, row - 1);
+  handlePossibleMove<kWhite>(line, row, line + 1, row - 2);
+  handlePossibleMove<kWhite>(line, row, line - 1, row - 2);
+  handlePossibleMove<kWhite>(line, row, line - 2, row + 1);
+  handlePossibleMove<kWhite>(line, row, line - 2, row - 1);
 }
 
-void MoveCalculator::calculateMovesForBishop(size_t line, size_t row) {
+template <bool kWhite, int kLineStep, int kRowStep>
+void MoveCalculator::calculateSlidingMoves(size_t line, size_t row) {
   for (int offset = 1;
-       handlePossibleMove(line, row, line + offset, row + offset);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line + offset, row - offset);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line - offset, row + offset);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line - offset, row - offset);
+       handlePossibleMove<kWhite>(line, row, line + kLineStep * offset, row + kRowStep * offset);
        ++offset);
 }
 
+template <bool kWhite>
+void MoveCalculator::calculateMovesForBishop(size_t line, size_t row) {
+  calculateSlidingMoves<kWhite, 1, 1>(line, row);
+  calculateSlidingMoves<kWhite, 1, -1>(line, row);
+  calculateSlidingMoves<kWhite, -1, 1>(line, row);
+  calculateSlidingMoves<kWhite, -1, -1>(line, row);
+}
+
+template <bool kWhite>
 void MoveCalculator::calculateMovesForRook(size_t line, size_t row) {
-  for (int offset = 1;
-       handlePossibleMove(line, row, line + offset, row);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line - offset, row);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line, row + offset);
-       ++offset);
-  for (int offset = 1;
-       handlePossibleMove(line, row, line, row - offset);
-       ++offset);
+  calculateSlidingMoves<kWhite, 1, 0>(line, row);
+  calculateSlidingMoves<kWhite, -1, 0>(line, row);
+  calculateSlidingMoves<kWhite, 0, 1>(line, row);
+  calculateSlidingMoves<kWhite, 0, -1>(line, row);
 }
 
+template <bool kWhite>
 void MoveCalculator::calculateMovesForQueen(size_t line, size_t row) {
-  calculateMovesForRook(line, row);
-  calculateMovesForBishop(line, row);
+  calculateMovesForRook<kWhite>(line, row);
+  calculateMovesForBishop<kWhite>(line, row);
 }
 
+template <bool kWhite>
 void MoveCalculator::calculateMovesForKing(size_t line, size_t row) {
-  handlePossibleMove(line, row, line + 1, row + 1);
-  handlePossibleMove(line, row, line + 1, row);
-  handlePossibleMove(line, row, line + 1, row - 1);
-  handlePossibleMove(line, row, line, row - 1);
-  handlePossibleMove(line, row, line - 1, row - 1);
-  handlePossibleMove(line, row, line - 1, row);
-  handlePossibleMove(line, row, line - 1, row + 1);
-  handlePossibleMove(line, row, line, row + 1);
-  if (look_for_king_capture_ == false) {
-    handlePossibleCastlings(line, row);
+  handlePossibleMove<kWhite>(line, row, line + 1, row + 1);
+  handlePossibleMove<kWhite>(line, row, line + 1, row);
+  handlePossibleMove<kWhite>(line, row, line + 1, row - 1);
+  handlePossibleMove<kWhite>(line, row, line, row - 1);
+  handlePossibleMove<kWhite>(line, row, line - 1, row - 1);
+  handlePossibleMove<kWhite>(line, row, line - 1, row);
+  handlePossibleMove<kWhite>(line, row, line - 1, row + 1);
+  handlePossibleMove<kWhite>(line, row, line, row + 1);
+  if (look_for_king_capture_ == false &&
+      line == kKingStartingLine && row == Side<kWhite>::kKingStartingRow) {
+    handlePossibleCastling<kWhite, true>();
+    handlePossibleCastling<kWhite, false>();
   }
 }
 
-void MoveCalculator::handlePossibleCastlings(size_t line, size_t row) {
-  const bool is_white = isWhite(board_.at(line, row));
-  const size_t king_starting_row = is_white ? 0 : Board::kBoardSize - 1;
-
-  if (line != kKingStartingLine || row != king_starting_row) {
+template <bool kWhite, bool kKingSide>
+void MoveCalculator::handlePossibleCastling() {
+  using S = Side<kWhite>;
+  constexpr Castling castling = kKingSide ? S::kKingSideCastling : S::kQueenSideCastling;
+  constexpr size_t row = S::kKingStartingRow;
+  constexpr size_t rooks_line = kKingSide ? kKingSideRookStartingLine : kQueenSideRookStartingLine;
+  constexpr int shift = kKingSide ? 1 : -1;
+  if (board_.canCastle(castling) == false || board_.at(rooks_line, row) != S::kRook) {
+    return;
+  }
+  if (board_.at(kKingStartingLine + shift, row) || board_.at(kKingStartingLine + 2 * shift, row)) {
     return;
   }
 
-  auto helper = [this](Castling castling, bool king_side, bool is_white, size_t row) {
-    if (board_.canCastle(castling) == false) {
-      return;
-    }
-    const char rook = is_white ? 'R' : 'r';
-    const size_t rooks_line = king_side ? kKingSideRookStartingLine : kQueenSideRookStartingLine;
-    if (board_.at(rooks_line, row) != rook) {
-      return;
-    }
-    const int shift = king_side ? 1 : -1;
-    if (board_.at(kKingStartingLine + shift, row) || board_.at(kKingStartingLine + 2 * shift, row)) {
-      return;
-    }
-
-    auto isMoveValid = [this, row](size_t new_line) -> bool {
-      Board copy = board_;
-      copy.changeSideToMove();
-      copy.setEnPassantTargetSquare(Square::InvalidSquare);
-      const char king = copy.at(kKingStartingLine, row);
-      assert (king == 'K' || king == 'k');
-      copy.at(kKingStartingLine, row) = 0x0;
-      copy.at(new_line, row) = king;
-      MoveCalculator calculator(copy, true);
-      try {
-        calculator.calculateAllMoves();
-        // No exception was thrown so move is valid.
-        return true;
-      } catch (KingInCheckException&) {
-      }
-      return false;
-    };
-
-    if (isMoveValid(kKingStartingLine) == false ||
-        isMoveValid(kKingStartingLine + shift) == false ||
-        isMoveValid(kKingStartingLine + 2 * shift) == false) {
-      return;
+  auto isMoveValid = [this](size_t new_line) -> bool {
+    Board copy = board_;
+    copy.changeSideToMove();
+    copy.setEnPassantTargetSquare(Square::InvalidSquare);
+    assert(copy.at(kKingStartingLine, row) == S::kKing);
+    copy.at(kKingStartingLine, row) = 0x0;
+    copy.at(new_line, row) = S::kKing;
+    INSTRUMENT_COUNT(NESTED_MOVE_CALCULATORS);
+    MoveCalculator calculator(copy, true);
+    try {
+      calculator.calculateAllMoves();
+      // No exception was thrown so move is valid.
+      return true;
+    } catch (KingInCheckException&) {
+      INSTRUMENT_COUNT(KING_IN_CHECK_EXCEPTIONS);
     }
-
-    // All checks are fine, castling is possible
-    Move move(board_, kKingStartingLine, row, kKingStartingLine + 2 * shift, row);
-    move.board.incrementNumberOfHalfMoves();
-    move.board.setEnPassantTargetSquare(Square::InvalidSquare);
-    move.board.resetCastlings(is_white);
-    const char king = move.board.at(kKingStartingLine, row);
-    move.board.at(kKingStartingLine, row) = 0x0;
-    move.board.at(rooks_line, row) = 0x0;
-    move.board.at(kKingStartingLine + 2 * shift, row) = king;
-    move.board.at(kKingStartingLine + shift, row) = rook;
-    move.castling = castling;
-    handleMove(move, false);
+    return false;
   };
 
-  if (is_white) {
-    helper(Castling::K, true, true, 0);
-    helper(Castling::Q, false, true, 0);
-  } else {
-    helper(Castling::k, true, false, Board::kBoardSize - 1);
-    helper(Castling::q, false, false, Board::kBoardSize - 1);
+  if (isMoveValid(kKingStartingLine) == false ||
+      isMoveValid(kKingStartingLine + shift) == false ||
+      isMoveValid(kKingStartingLine + 2 * shift) == false) {
+    return;
   }
+
+  // All checks are fine, castling is possible
+  Move move(board_, kKingStartingLine, row, kKingStartingLine + 2 * shift, row);
+  move.board.incrementNumberOfHalfMoves();
+  move.board.setEnPassantTargetSquare(Square::InvalidSquare);
+  move.board.resetCastlings(kWhite);
+  move.board.at(kKingStartingLine, row) = 0x0;
+  move.board.at(rooks_line, row) = 0x0;
+  move.board.at(kKingStartingLine + 2 * shift, row) = S::kKing;
+  move.board.at(kKingStartingLine + shift, row) = S::kRook;
+  move.castling = castling;
+  handleMove(move, false);
 }
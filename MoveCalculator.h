@@ -42,27 +42,34 @@ class MoveCalculator {
   }
 
   std::vector<Move> calculateAllMoves();
+  // Legal moves of figures |figure| ("PNBRQK") of the side to move.
+  std::vector<Move> calculateMovesOfFigure(char figure);
   bool isCheck() const;
 
  private:
   struct KingInCheckException {};
 
-  bool isValidMove(size_t old_line, size_t old_row,
-                   size_t new_line, size_t new_row);
-  void calculateAllMovesForFigure(size_t line, size_t row);
-  void calculateMovesForPawn(size_t line, size_t row);
-  void calculateMovesForKnight(size_t line, size_t row);
-  void calculateMovesForBishop(size_t line, size_t row);
-  void calculateMovesForRook(size_t line, size_t row);
-  void calculateMovesForQueen(size_t line, size_t row);
-  void calculateMovesForKing(size_t line, size_t row);
+  // Templates are instantiated for the color of moving figures,
+  // which is chosen once per position by calculateAllMoves().
+  template <bool kWhite> void calculateAllMoves();
+  template <bool kWhite> void calculateMovesOfFigure(char figure);
+  template <bool kWhite> void calculateAllMovesForFigure(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForPawn(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForKnight(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForBishop(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForRook(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForQueen(size_t line, size_t row);
+  template <bool kWhite> void calculateMovesForKing(size_t line, size_t row);
+  template <bool kWhite, int kLineStep, int kRowStep>
+  void calculateSlidingMoves(size_t line, size_t row);
 
+  template <bool kWhite>
   bool handlePossibleMove(size_t old_line, size_t old_row,
                           size_t new_line, size_t new_row);
   void handleMove(Move& board, bool is_king_capture);
-  void handlePossiblePawnsCapture(size_t line, size_t row);
-  void handlePawnPromotion(const Move& move, size_t line, size_t row);
-  void handlePossibleCastlings(size_t line, size_t row);
+  template <bool kWhite> void handlePossiblePawnsCapture(size_t line, size_t row, int shift);
+  template <bool kWhite> void handlePawnPromotion(const Move& move, size_t line, size_t row);
+  template <bool kWhite, bool kKingSide> void handlePossibleCastling();
   void resetCastlings(Board& board, char figure, size_t line, size_t row) const;
   void updateInsufficientMaterialForMove(Move& move) const;
 
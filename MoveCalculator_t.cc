@@ -465,4 +465,16 @@ TEST_START
 TEST_END
 }
 
+TEST_PROCEDURE(MovesOfFigure) {
+TEST_START
+  Board board("r3k2r/8/8/8/8/8/8/RN2K2R b KQkq - 0 1");
+  std::vector<Move> moves = MoveCalculator(board).calculateMovesOfFigure('K');
+  // Five king steps and both castlings.
+  VERIFY_EQUALS(moves.size(), 7lu);
+  VERIFY_EQUALS(MoveCalculator(board).calculateMovesOfFigure('N').size(), 0lu);
+  std::vector<Move> all_moves = MoveCalculator(board).calculateAllMoves();
+  VERIFY_EQUALS(MoveCalculator(board).calculateMovesOfFigure('R').size(), all_moves.size() - 7lu);
+TEST_END
+}
+
 } // unnamed namespace
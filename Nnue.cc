@@ -0,0 +1,300 @@
+#include "Nnue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+#include "BoardScan.h"
+#include "MappedFile.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+namespace {
+
+constexpr char kFigureTypes[] = "PNBRQK";
+constexpr size_t kNumberOfFigureTypes = 6;
+constexpr size_t kSquares = Board::kBoardSize * Board::kBoardSize;
+constexpr size_t kVersionOffset = 4;
+constexpr size_t kHiddenSizeOffset = 8;
+constexpr char kVersion = 1;
+// A move changes at most two squares besides castling (four) and
+// en passant (three), each square adds and removes at most one figure.
+constexpr size_t kMaxChangedFeatures = 4;
+constexpr size_t kNetworkSize =
+    Nnue::kHeaderSize + Nnue::kHiddenSize * sizeof(int16_t) +
+    Nnue::kNumberOfFeatures * Nnue::kHiddenSize * sizeof(int16_t) +
+    2 * Nnue::kHiddenSize * sizeof(int8_t) + sizeof(int32_t);
+
+struct Kernels {
+  Nnue::Implementation implementation;
+  // to = from + sum(added) - sum(removed), each a row of kHiddenSize weights.
+  void (*update)(const int16_t* from, int16_t* to,
+                 const int16_t* const* added, size_t number_of_added,
+                 const int16_t* const* removed, size_t number_of_removed);
+  // Dot product of clipped hidden layers of both perspectives with output weights.
+  int32_t (*forward)(const int16_t* us, const int16_t* them, const int8_t* weights);
+};
+
+void updateScalar(const int16_t* from, int16_t* to,
+                  const int16_t* const* added, size_t number_of_added,
+                  const int16_t* const* removed, size_t number_of_removed) {
+  for (size_t i = 0; i < Nnue::kHiddenSize; ++i) {
+    int16_t value = from[i];
+    for (size_t j = 0; j < number_of_added; ++j) {
+      value += added[j][i];
+    }
+    for (size_t j = 0; j < number_of_removed; ++j) {
+      value -= removed[j][i];
+    }
+    to[i] = value;
+  }
+}
+
+int32_t forwardScalar(const int16_t* us, const int16_t* them, const int8_t* weights) {
+  int32_t result = 0;
+  for (size_t i = 0; i < Nnue::kHiddenSize; ++i) {
+    result += std::clamp<int32_t>(us[i], 0, Nnue::kActivationLimit) * weights[i];
+    result += std::clamp<int32_t>(them[i], 0, Nnue::kActivationLimit) *
+              weights[Nnue::kHiddenSize + i];
+  }
+  return result;
+}
+
+#ifdef NNUE_X86
+
+constexpr size_t kInt16PerRegister = 16;
+
+__attribute__((target("avx2")))
+void updateAVX2(const int16_t* from, int16_t* to,
+                const int16_t* const* added, size_t number_of_added,
+                const int16_t* const* removed, size_t number_of_removed) {
+  for (size_t i = 0; i < Nnue::kHiddenSize; i += kInt16PerRegister) {
+    __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+    for (size_t j = 0; j < number_of_added; ++j) {
+      value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(added[j] + i)));
+    }
+    for (size_t j = 0; j < number_of_removed; ++j) {
+      value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(removed[j] + i)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i), value);
+  }
+}
+
+// Clips 32 neurons to unsigned bytes and multiplies them with int8 weights.
+__attribute__((target("avx2")))
+inline __m256i forwardLayerAVX2(const int16_t* values, const int8_t* weights) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i limit = _mm256_set1_epi16(Nnue::kActivationLimit);
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i sum = _mm256_setzero_si256();
+  for (size_t i = 0; i < Nnue::kHiddenSize; i += 2 * kInt16PerRegister) {
+    const __m256i low = _mm256_min_epi16(_mm256_max_epi16(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), zero), limit);
+    const __m256i high = _mm256_min_epi16(_mm256_max_epi16(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + kInt16PerRegister)), zero), limit);
+    // Packing works within 128-bit lanes, permutation restores the order of neurons.
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+    const __m256i products = _mm256_maddubs_epi16(
+        packed, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i)));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+  }
+  return sum;
+}
+
+__attribute__((target("avx2")))
+int32_t forwardAVX2(const int16_t* us, const int16_t* them, const int8_t* weights) {
+  const __m256i sum = _mm256_add_epi32(forwardLayerAVX2(us, weights),
+                                       forwardLayerAVX2(them, weights + Nnue::kHiddenSize));
+  __m128i result = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  result = _mm_add_epi32(result, _mm_shuffle_epi32(result, 0x4E));
+  result = _mm_add_epi32(result, _mm_shuffle_epi32(result, 0xB1));
+  return _mm_cvtsi128_si32(result);
+}
+
+#endif  // NNUE_X86
+
+constexpr Kernels kScalarKernels{Nnue::Implementation::SCALAR, updateScalar, forwardScalar};
+#ifdef NNUE_X86
+constexpr Kernels kAVX2Kernels{Nnue::Implementation::AVX2, updateAVX2, forwardAVX2};
+#endif
+
+bool isSupported(Nnue::Implementation implementation) {
+  switch (implementation) {
+    case Nnue::Implementation::SCALAR:
+      return true;
+    case Nnue::Implementation::AVX2:
+#ifdef NNUE_X86
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+const Kernels* getKernels(Nnue::Implementation implementation) {
+#ifdef NNUE_X86
+  if (implementation == Nnue::Implementation::AVX2) {
+    return &kAVX2Kernels;
+  }
+#endif
+  return &kScalarKernels;
+}
+
+// May be switched while other threads evaluate.
+std::atomic<const Kernels*> kernels{getKernels(isSupported(Nnue::Implementation::AVX2) ?
+    Nnue::Implementation::AVX2 : Nnue::Implementation::SCALAR)};
+
+template <typename T>
+const unsigned char* copyValues(const unsigned char* data, std::vector<T>& values, size_t size) {
+  values.resize(size);
+  memcpy(values.data(), data, size * sizeof(T));
+  return data + size * sizeof(T);
+}
+
+template <typename T>
+void writeValues(std::ofstream& file, const std::vector<T>& values) {
+  file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+}  // unnamed namespace
+
+constexpr char Nnue::kMagic[];
+
+Nnue::Nnue(const std::string& path) {
+  MappedFile file(path);
+  uint32_t hidden_size = 0;
+  if (file.size() >= kHeaderSize) {
+    memcpy(&hidden_size, file.data() + kHiddenSizeOffset, sizeof(hidden_size));
+  }
+  if (file.size() != kNetworkSize ||
+      memcmp(file.data(), kMagic, 4) != 0 ||
+      file.data()[kVersionOffset] != kVersion ||
+      hidden_size != kHiddenSize) {
+    throw InvalidNetworkException(path);
+  }
+  const unsigned char* data = file.data() + kHeaderSize;
+  data = copyValues(data, weights_.feature_biases, kHiddenSize);
+  data = copyValues(data, weights_.feature_weights, kNumberOfFeatures * kHiddenSize);
+  data = copyValues(data, weights_.output_weights, 2 * kHiddenSize);
+  memcpy(&weights_.output_bias, data, sizeof(weights_.output_bias));
+}
+
+size_t Nnue::getFeature(char figure, size_t line, size_t row, bool white_perspective) {
+  const size_t type = strchr(kFigureTypes, toupper(figure)) - kFigureTypes;
+  const bool own = (isupper(figure) != 0) == white_perspective;
+  const size_t relative_row = white_perspective ? row : Board::kBoardSize - 1 - row;
+  return ((own ? 0 : kNumberOfFigureTypes) + type) * kSquares +
+         relative_row * Board::kBoardSize + line;
+}
+
+void Nnue::refresh(const Board& board, Accumulator& accumulator) const {
+  uint64_t white, black;
+  board_scan::calculateColorMasks(board, white, black);
+  const int16_t* added[2][kSquares];
+  size_t number_of_added = 0;
+  for (uint64_t figures = white | black; figures; figures &= figures - 1) {
+    const unsigned index = __builtin_ctzll(figures);
+    const size_t line = board_scan::getLine(index);
+    const size_t row = board_scan::getRow(index);
+    const char figure = board.at(line, row);
+    added[0][number_of_added] = getFeatureWeights(getFeature(figure, line, row, true));
+    added[1][number_of_added] = getFeatureWeights(getFeature(figure, line, row, false));
+    ++number_of_added;
+  }
+  const Kernels* active_kernels = kernels.load(std::memory_order_relaxed);
+  for (size_t perspective = 0; perspective < 2; ++perspective) {
+    active_kernels->update(weights_.feature_biases.data(), accumulator.values[perspective],
+                           added[perspective], number_of_added, nullptr, 0);
+  }
+}
+
+void Nnue::update(const Accumulator& from, const Board& from_board,
+                  const Board& to_board, Accumulator& to) const {
+  const char* old_squares = from_board.getSquares();
+  const char* new_squares = to_board.getSquares();
+  const int16_t* added[2][kMaxChangedFeatures];
+  const int16_t* removed[2][kMaxChangedFeatures];
+  size_t number_of_added = 0;
+  size_t number_of_removed = 0;
+  for (size_t chunk = 0; chunk < kSquares; chunk += sizeof(uint64_t)) {
+    uint64_t old_chunk, new_chunk;
+    memcpy(&old_chunk, old_squares + chunk, sizeof(uint64_t));
+    memcpy(&new_chunk, new_squares + chunk, sizeof(uint64_t));
+    if (old_chunk == new_chunk) {
+      continue;
+    }
+    for (size_t index = chunk; index < chunk + sizeof(uint64_t); ++index) {
+      if (old_squares[index] == new_squares[index]) {
+        continue;
+      }
+      if (number_of_added == kMaxChangedFeatures || number_of_removed == kMaxChangedFeatures) {
+        // Boards are not one move apart.
+        refresh(to_board, to);
+        return;
+      }
+      const size_t line = board_scan::getLine(index);
+      const size_t row = board_scan::getRow(index);
+      if (old_squares[index]) {
+        removed[0][number_of_removed] = getFeatureWeights(getFeature(old_squares[index], line, row, true));
+        removed[1][number_of_removed] = getFeatureWeights(getFeature(old_squares[index], line, row, false));
+        ++number_of_removed;
+      }
+      if (new_squares[index]) {
+        added[0][number_of_added] = getFeatureWeights(getFeature(new_squares[index], line, row, true));
+        added[1][number_of_added] = getFeatureWeights(getFeature(new_squares[index], line, row, false));
+        ++number_of_added;
+      }
+    }
+  }
+  const Kernels* active_kernels = kernels.load(std::memory_order_relaxed);
+  for (size_t perspective = 0; perspective < 2; ++perspective) {
+    active_kernels->update(from.values[perspective], to.values[perspective],
+                           added[perspective], number_of_added,
+                           removed[perspective], number_of_removed);
+  }
+}
+
+int Nnue::evaluate(const Accumulator& accumulator, bool white_to_move) const {
+  const size_t us = white_to_move ? 0 : 1;
+  const int64_t output = static_cast<int64_t>(kernels.load(std::memory_order_relaxed)->forward(
+      accumulator.values[us], accumulator.values[1 - us], weights_.output_weights.data())) +
+      weights_.output_bias;
+  return static_cast<int>(output * kOutputScale / (kActivationLimit * kOutputWeightScale));
+}
+
+int Nnue::evaluate(const Board& board) const {
+  Accumulator accumulator;
+  refresh(board, accumulator);
+  return evaluate(accumulator, board.whiteToMove());
+}
+
+void Nnue::write(const std::string& path, const Weights& weights) {
+  std::ofstream file(path, std::ios::binary);
+  const char header[kHeaderSize - sizeof(uint32_t)] = {
+      kMagic[0], kMagic[1], kMagic[2], kMagic[3], kVersion, 0, 0, 0};
+  const uint32_t hidden_size = kHiddenSize;
+  file.write(header, sizeof(header));
+  file.write(reinterpret_cast<const char*>(&hidden_size), sizeof(hidden_size));
+  writeValues(file, weights.feature_biases);
+  writeValues(file, weights.feature_weights);
+  writeValues(file, weights.output_weights);
+  file.write(reinterpret_cast<const char*>(&weights.output_bias), sizeof(weights.output_bias));
+}
+
+Nnue::Implementation Nnue::getImplementation() {
+  return kernels.load(std::memory_order_relaxed)->implementation;
+}
+
+bool Nnue::setImplementation(Implementation implementation) {
+  if (!isSupported(implementation)) {
+    return false;
+  }
+  kernels.store(getKernels(implementation), std::memory_order_relaxed);
+  return true;
+}
@@ -0,0 +1,85 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+// Efficiently updatable neural network evaluation. For each perspective
+// (white, black) 768 piece-square inputs feed kHiddenSize neurons held in an
+// Accumulator, which is updated with the few changed squares of a move.
+// Clipped hidden layers of both perspectives, side to move first, give
+// one output.
+//
+// Input of figure on square (line, row) seen from a perspective is
+// ((own ? 0 : 6) + "PNBRQK" index) * 64 + relative_row * 8 + line,
+// where relative_row is mirrored for black.
+//
+// File layout (little endian): magic "CKNN", version byte, three zero bytes,
+// uint32 hidden size, int16 feature biases[hidden], int16 feature
+// weights[768][hidden], int8 output weights[2 * hidden], int32 output bias.
+class Nnue {
+ public:
+  struct InvalidNetworkException {
+    InvalidNetworkException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  enum class Implementation {
+    SCALAR,
+    AVX2
+  };
+
+  static constexpr size_t kNumberOfFeatures = 768;
+  static constexpr size_t kHiddenSize = 256;
+  static constexpr size_t kHeaderSize = 12;
+  static constexpr char kMagic[] = "CKNN";
+  // Hidden neurons are clipped to [0, kActivationLimit] and output weights
+  // are scaled by kOutputWeightScale, output is scaled to centipawns with kOutputScale.
+  static constexpr int kActivationLimit = 127;
+  static constexpr int kOutputWeightScale = 64;
+  static constexpr int kOutputScale = 400;
+
+  struct Weights {
+    std::vector<int16_t> feature_biases;
+    std::vector<int16_t> feature_weights;
+    std::vector<int8_t> output_weights;
+    int32_t output_bias{0};
+  };
+
+  // Hidden layer of white's and black's perspective.
+  struct alignas(32) Accumulator {
+    int16_t values[2][kHiddenSize];
+  };
+
+  Nnue(const std::string& path);
+
+  static size_t getFeature(char figure, size_t line, size_t row, bool white_perspective);
+
+  void refresh(const Board& board, Accumulator& accumulator) const;
+  // Calculates accumulator of |to_board| from the one of |from_board|.
+  void update(const Accumulator& from, const Board& from_board,
+              const Board& to_board, Accumulator& to) const;
+
+  // Centipawns from the side to move point of view.
+  int evaluate(const Accumulator& accumulator, bool white_to_move) const;
+  int evaluate(const Board& board) const;
+
+  static void write(const std::string& path, const Weights& weights);
+
+  static Implementation getImplementation();
+  // Returns false if |implementation| is not supported by the CPU.
+  static bool setImplementation(Implementation implementation);
+
+ private:
+  const int16_t* getFeatureWeights(size_t feature) const {
+    return &weights_.feature_weights[feature * kHiddenSize];
+  }
+
+  Weights weights_;
+};
+
+#endif  // NNUE_H
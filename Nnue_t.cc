@@ -0,0 +1,150 @@
+/* Component tests for class Nnue */
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MoveCalculator.h"
+#include "Nnue.h"
+#include "utils/Test.h"
+
+namespace {
+
+const std::string kNetworkPath = "/tmp/nnue_tests.nnue";
+
+Nnue::Weights createWeights(unsigned seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> bias(-16, 64);
+  std::uniform_int_distribution<int> feature_weight(-12, 12);
+  std::uniform_int_distribution<int> output_weight(-128, 127);
+  Nnue::Weights weights;
+  for (size_t i = 0; i < Nnue::kHiddenSize; ++i) {
+    weights.feature_biases.push_back(bias(generator));
+  }
+  for (size_t i = 0; i < Nnue::kNumberOfFeatures * Nnue::kHiddenSize; ++i) {
+    weights.feature_weights.push_back(feature_weight(generator));
+  }
+  for (size_t i = 0; i < 2 * Nnue::kHiddenSize; ++i) {
+    weights.output_weights.push_back(output_weight(generator));
+  }
+  weights.output_bias = 1000;
+  return weights;
+}
+
+bool accumulatorsEqual(const Nnue::Accumulator& first, const Nnue::Accumulator& second) {
+  for (size_t perspective = 0; perspective < 2; ++perspective) {
+    for (size_t i = 0; i < Nnue::kHiddenSize; ++i) {
+      if (first.values[perspective][i] != second.values[perspective][i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST_PROCEDURE(Nnue_features) {
+  TEST_START
+  // White pawn on e2 seen by white and by black.
+  VERIFY_EQUALS(Nnue::getFeature('P', 4, 1, true), 12lu);
+  VERIFY_EQUALS(Nnue::getFeature('P', 4, 1, false), 6 * 64 + 6 * 8 + 4lu);
+  // Black king on e8 is mirrored to e1 for black.
+  VERIFY_EQUALS(Nnue::getFeature('k', 4, 7, false), 5 * 64 + 4lu);
+  VERIFY_EQUALS(Nnue::getFeature('k', 4, 7, true), 11 * 64 + 7 * 8 + 4lu);
+  TEST_END
+}
+
+TEST_PROCEDURE(Nnue_loads_network) {
+  TEST_START
+  Nnue::Weights weights = createWeights(0);
+  std::fill(weights.feature_weights.begin(), weights.feature_weights.end(), 0);
+  std::fill(weights.feature_biases.begin(), weights.feature_biases.end(), 200);
+  std::fill(weights.output_weights.begin(), weights.output_weights.end(), 0);
+  weights.output_weights[0] = 2;
+  weights.output_weights[Nnue::kHiddenSize] = 1;
+  weights.output_bias = -127 * 64;
+  Nnue::write(kNetworkPath, weights);
+  Nnue network(kNetworkPath);
+  // Neurons are clipped at 127: (2 * 127 + 127 - 127 * 64) * 400 / (127 * 64).
+  VERIFY_EQUALS(network.evaluate(Board("4k3/8/8/8/8/8/8/4K3 w - - 0 1")), -381);
+  std::remove(kNetworkPath.c_str());
+
+  bool exception_was_thrown = false;
+  try {
+    Nnue::write(kNetworkPath, Nnue::Weights());
+    Nnue invalid_network(kNetworkPath);
+  } catch (Nnue::InvalidNetworkException& e) {
+    exception_was_thrown = e.path == kNetworkPath;
+  }
+  VERIFY_TRUE(exception_was_thrown);
+  std::remove(kNetworkPath.c_str());
+  TEST_END
+}
+
+TEST_PROCEDURE(Nnue_updates_accumulator_incrementally) {
+  TEST_START
+  Nnue::write(kNetworkPath, createWeights(1));
+  const Nnue network(kNetworkPath);
+  std::remove(kNetworkPath.c_str());
+  // Positions with castlings, en passant captures and promotions.
+  const std::vector<std::string> fens = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"
+  };
+  for (const std::string& fen: fens) {
+    const Board board(fen);
+    Nnue::Accumulator accumulator;
+    network.refresh(board, accumulator);
+    for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+      Nnue::Accumulator updated;
+      Nnue::Accumulator refreshed;
+      network.update(accumulator, board, move.board, updated);
+      network.refresh(move.board, refreshed);
+      VERIFY_TRUE(accumulatorsEqual(updated, refreshed));
+    }
+    // Boards more than one move apart.
+    Nnue::Accumulator updated;
+    Nnue::Accumulator refreshed;
+    network.update(accumulator, board, Board(fens[0]), updated);
+    network.refresh(Board(fens[0]), refreshed);
+    VERIFY_TRUE(accumulatorsEqual(updated, refreshed));
+  }
+  TEST_END
+}
+
+TEST_PROCEDURE(Nnue_is_symmetric) {
+  TEST_START
+  Nnue::write(kNetworkPath, createWeights(2));
+  const Nnue network(kNetworkPath);
+  std::remove(kNetworkPath.c_str());
+  // Same position with colors swapped.
+  VERIFY_EQUALS(network.evaluate(Board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")),
+                network.evaluate(Board("r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1")));
+  TEST_END
+}
+
+TEST_PROCEDURE(Nnue_implementations_agree) {
+  TEST_START
+  Nnue::write(kNetworkPath, createWeights(3));
+  const Nnue network(kNetworkPath);
+  std::remove(kNetworkPath.c_str());
+  const Nnue::Implementation selected = Nnue::getImplementation();
+  const Board board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+  VERIFY_TRUE(Nnue::setImplementation(Nnue::Implementation::SCALAR));
+  std::vector<int> expected;
+  for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+    expected.push_back(network.evaluate(move.board));
+  }
+  if (Nnue::setImplementation(Nnue::Implementation::AVX2)) {
+    std::vector<int> results;
+    for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+      results.push_back(network.evaluate(move.board));
+    }
+    VERIFY_EQUALS(results, expected);
+  }
+  Nnue::setImplementation(selected);
+  TEST_END
+}
+
+}  // unnamed namespace
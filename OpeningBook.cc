@@ -0,0 +1,118 @@
+#include "OpeningBook.h"
+
+#include "Zobrist.h"
+
+
+namespace {
+
+uint64_t readBigEndian(const unsigned char* data, size_t bytes) {
+  uint64_t result = 0ull;
+  for (size_t i = 0; i < bytes; ++i) {
+    result = (result << 8) | data[i];
+  }
+  return result;
+}
+
+uint16_t getPromotionCode(char promotion) {
+  switch (promotion) {
+    case 'N':
+    case 'n':
+      return 1;
+    case 'B':
+    case 'b':
+      return 2;
+    case 'R':
+    case 'r':
+      return 3;
+    case 'Q':
+    case 'q':
+      return 4;
+    default:
+      break;
+  }
+  return 0;
+}
+
+}  // unnamed namespace
+
+
+OpeningBook::OpeningBook(const std::string& path) : file_(path) {
+  if (file_.size() % kEntrySize != 0) {
+    throw InvalidBookException(path);
+  }
+  number_of_entries_ = file_.size() / kEntrySize;
+}
+
+OpeningBook::Entry OpeningBook::readEntry(size_t index) const {
+  const unsigned char* data = file_.data() + index * kEntrySize;
+  Entry entry;
+  entry.key = readBigEndian(data, 8);
+  entry.move = static_cast<uint16_t>(readBigEndian(data + 8, 2));
+  entry.weight = static_cast<uint16_t>(readBigEndian(data + 10, 2));
+  return entry;
+}
+
+std::vector<OpeningBook::Entry> OpeningBook::findEntries(uint64_t key) const {
+  size_t first = 0;
+  size_t last = number_of_entries_;
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (readEntry(middle).key < key) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  std::vector<Entry> entries;
+  for (size_t index = first; index < number_of_entries_; ++index) {
+    Entry entry = readEntry(index);
+    if (entry.key != key) {
+      break;
+    }
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+uint16_t OpeningBook::encodeMove(const Move& move) {
+  size_t new_line = move.new_square.letter - 'a';
+  const size_t new_row = move.new_square.number - '1';
+  const size_t old_line = move.old_square.letter - 'a';
+  const size_t old_row = move.old_square.number - '1';
+  // Polyglot encodes castling as the king capturing its own rook.
+  if (move.castling == Castling::K || move.castling == Castling::k) {
+    new_line = Board::kBoardSize - 1;
+  } else if (move.castling == Castling::Q || move.castling == Castling::q) {
+    new_line = 0;
+  }
+  return static_cast<uint16_t>(new_line | (new_row << 3) | (old_line << 6) |
+                               (old_row << 9) | (getPromotionCode(move.promotion) << 12));
+}
+
+std::optional<Move> OpeningBook::findMove(const Board& board, unsigned random_value) const {
+  std::vector<Entry> entries = findEntries(zobrist::hash(board));
+  unsigned total_weight = 0;
+  for (const Entry& entry: entries) {
+    total_weight += entry.weight;
+  }
+  if (total_weight == 0) {
+    return std::nullopt;
+  }
+  unsigned chosen = random_value % total_weight;
+  uint16_t book_move = 0;
+  for (const Entry& entry: entries) {
+    if (chosen < entry.weight) {
+      book_move = entry.move;
+      break;
+    }
+    chosen -= entry.weight;
+  }
+  MoveCalculator calculator(board);
+  for (const Move& move: calculator.calculateAllMoves()) {
+    if (encodeMove(move) == book_move) {
+      return move;
+    }
+  }
+  // Book entry does not match any legal move (hash collision or broken book).
+  return std::nullopt;
+}
@@ -0,0 +1,47 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MoveCalculator.h"
+
+// Opening book in Polyglot .bin layout: 16-byte big-endian entries
+// (key, move, weight, learn) sorted by key. Keys come from zobrist::hash().
+class OpeningBook {
+ public:
+  struct InvalidBookException {
+    InvalidBookException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  struct Entry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+  };
+
+  static constexpr size_t kEntrySize = 16;
+
+  OpeningBook(const std::string& path);
+
+  std::vector<Entry> findEntries(uint64_t key) const;
+
+  // Picks one of the book moves for |board| with probability proportional
+  // to its weight; |random_value| selects the move. Returns nothing when
+  // the position is not in the book.
+  std::optional<Move> findMove(const Board& board, unsigned random_value) const;
+
+  static uint16_t encodeMove(const Move& move);
+
+ private:
+  Entry readEntry(size_t index) const;
+
+  MappedFile file_;
+  size_t number_of_entries_{0};
+};
+
+#endif  // OPENING_BOOK_H
@@ -0,0 +1,141 @@
+/* Component tests for class OpeningBook */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "OpeningBook.h"
+#include "Zobrist.h"
+#include "utils/Test.h"
+
+namespace {
+
+const char kInitialFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+void writeBigEndian(std::ofstream& file, uint64_t value, size_t bytes) {
+  for (size_t i = bytes; i > 0; --i) {
+    file.put(static_cast<char>((value >> (8 * (i - 1))) & 0xFF));
+  }
+}
+
+std::string writeBook(std::vector<OpeningBook::Entry> entries) {
+  std::sort(entries.begin(), entries.end(),
+            [](const OpeningBook::Entry& a, const OpeningBook::Entry& b) {
+              return a.key < b.key;
+            });
+  const std::string path = "/tmp/opening_book_tests.bin";
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  for (const auto& entry: entries) {
+    writeBigEndian(file, entry.key, 8);
+    writeBigEndian(file, entry.move, 2);
+    writeBigEndian(file, entry.weight, 2);
+    writeBigEndian(file, 0, 4);
+  }
+  return path;
+}
+
+const Move& findMove(const std::vector<Move>& moves, const char* old_square, const char* new_square) {
+  for (const auto& move: moves) {
+    if (move.old_square == Square(old_square) && move.new_square == Square(new_square)) {
+      return move;
+    }
+  }
+  assert(!"Move not found");
+  return moves.front();
+}
+
+
+TEST_PROCEDURE(OpeningBook_encodes_moves_as_polyglot) {
+  TEST_START
+  {
+    Board board(kInitialFen);
+    auto moves = MoveCalculator(board).calculateAllMoves();
+    // e2e4: to e4 (file 4, row 3), from e2 (file 4, row 1)
+    VERIFY_EQUALS(OpeningBook::encodeMove(findMove(moves, "e2", "e4")), 4 | (3 << 3) | (4 << 6) | (1 << 9));
+  }
+  {
+    Board board("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    auto moves = MoveCalculator(board).calculateAllMoves();
+    // Castling is stored as e1h1 and e1a1.
+    VERIFY_EQUALS(OpeningBook::encodeMove(findMove(moves, "e1", "g1")), 7 | (4 << 6));
+    VERIFY_EQUALS(OpeningBook::encodeMove(findMove(moves, "e1", "c1")), 0 | (4 << 6));
+  }
+  TEST_END
+}
+
+TEST_PROCEDURE(OpeningBook_picks_weighted_moves) {
+  TEST_START
+  Board board(kInitialFen);
+  auto moves = MoveCalculator(board).calculateAllMoves();
+  const uint64_t key = zobrist::hash(board);
+  const uint16_t e4 = OpeningBook::encodeMove(findMove(moves, "e2", "e4"));
+  const uint16_t d4 = OpeningBook::encodeMove(findMove(moves, "d2", "d4"));
+  const uint16_t a4 = OpeningBook::encodeMove(findMove(moves, "a2", "a4"));
+  std::string path = writeBook({{key ^ 1, e4, 5}, {key, e4, 3}, {key, a4, 0}, {key, d4, 1}, {key + 1, d4, 7}});
+  OpeningBook book(path);
+  VERIFY_EQUALS(book.findEntries(key).size(), 3lu);
+  for (unsigned random_value = 0; random_value < 3; ++random_value) {
+    auto move = book.findMove(board, random_value);
+    VERIFY_TRUE(move);
+    VERIFY_TRUE(move->new_square == Square("e4"));
+  }
+  auto move = book.findMove(board, 3);
+  VERIFY_TRUE(move);
+  VERIFY_TRUE(move->new_square == Square("d4"));
+  VERIFY_FALSE(book.findMove(Board("8/8/3k4/4Q3/8/8/8/4K3 b - - 0 1"), 0));
+  std::remove(path.c_str());
+  TEST_END
+}
+
+TEST_PROCEDURE(OpeningBook_invalid_file) {
+  TEST_START
+  const std::string path = "/tmp/opening_book_tests.bin";
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a book";
+  try {
+    OpeningBook book(path);
+  } catch (OpeningBook::InvalidBookException& e) {
+    std::remove(path.c_str());
+    RETURN;
+  }
+  NOT_REACHED("Exception InvalidBookException was not thrown");
+  TEST_END
+}
+
+TEST_PROCEDURE(Zobrist_hash_depends_on_position_only) {
+  TEST_START
+  Board board(kInitialFen);
+  Board other_counters("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 3 7");
+  VERIFY_EQUALS(zobrist::hash(board), zobrist::hash(other_counters));
+  VERIFY_FALSE(zobrist::hash(board) ==
+               zobrist::hash(Board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1")));
+  VERIFY_FALSE(zobrist::hash(board) ==
+               zobrist::hash(Board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w Kkq - 0 1")));
+  // En passant square counts only when the capture is possible.
+  VERIFY_EQUALS(zobrist::hash(Board("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1")),
+                zobrist::hash(Board("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1")));
+  VERIFY_FALSE(zobrist::hash(Board("rnbqkbnr/pppp1ppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1")) ==
+               zobrist::hash(Board("rnbqkbnr/pppp1ppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1")));
+  TEST_END
+}
+
+TEST_PROCEDURE(Zobrist_update_matches_hash) {
+  TEST_START
+  // Castlings, en passant captures and promotions.
+  const std::vector<std::string> fens = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"
+  };
+  for (const std::string& fen: fens) {
+    const Board board(fen);
+    const uint64_t key = zobrist::hash(board);
+    for (const Move& move: MoveCalculator(board).calculateAllMoves()) {
+      VERIFY_EQUALS(zobrist::update(key, board, move.board), zobrist::hash(move.board));
+    }
+  }
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -0,0 +1,96 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Board.h"
+#include "PackedBoard.h"
+
+namespace {
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " <input.fen> <output.pb>" << std::endl
+            << "       " << program << " --unpack <input.pb>" << std::endl
+            << "Input has one FEN or EPD position per line; EPD operations are dropped "
+            << "and missing move counters are taken as \"0 1\"." << std::endl;
+}
+
+// FEN of an FEN or EPD line.
+Board readBoard(const std::string& line) {
+  std::istringstream fields(line);
+  std::string field;
+  std::string fen;
+  for (int i = 0; i < 6 && fields >> field; ++i) {
+    fen += (i > 0 ? " " : "") + field;
+  }
+  try {
+    return Board(fen);
+  } catch (Board::InvalidFENException&) {
+    std::istringstream epd_fields(line);
+    std::string epd;
+    for (int i = 0; i < 4 && epd_fields >> field; ++i) {
+      epd += (i > 0 ? " " : "") + field;
+    }
+    return Board(epd + " 0 1");
+  }
+}
+
+int pack(const std::string& input_path, const std::string& output_path) {
+  std::ifstream input(input_path);
+  if (!input) {
+    std::cerr << "Cannot open " << input_path << std::endl;
+    return 1;
+  }
+  PackedBoardWriter writer(output_path);
+  std::string line;
+  size_t line_number = 0;
+  size_t skipped = 0;
+  while (std::getline(input, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    try {
+      writer.write(readBoard(line));
+    } catch (Board::InvalidFENException&) {
+      std::cerr << input_path << ":" << line_number << ": invalid position" << std::endl;
+      ++skipped;
+    } catch (PackedBoard::TooManyFiguresException&) {
+      std::cerr << input_path << ":" << line_number << ": too many figures" << std::endl;
+      ++skipped;
+    }
+  }
+  writer.flush();
+  std::cerr << "Packed " << writer.size() << " positions, skipped " << skipped << std::endl;
+  return 0;
+}
+
+int unpack(const std::string& input_path) {
+  PackedBoardReader reader(input_path);
+  for (const PackedBoard& packed: reader) {
+    std::cout << packed.toBoard().createFEN() << "\n";
+  }
+  std::cout.flush();
+  return 0;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  try {
+    return std::string(argv[1]) == "--unpack" ? unpack(argv[2]) : pack(argv[1], argv[2]);
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+  } catch (PackedBoardReader::InvalidFileException& e) {
+    std::cerr << "Invalid packed positions file " << e.path << std::endl;
+  } catch (PackedBoardWriter::WriteFailedException& e) {
+    std::cerr << "Cannot write " << e.path << std::endl;
+  } catch (PackedBoard::InvalidPackedBoardException&) {
+    std::cerr << "Invalid packed position" << std::endl;
+  }
+  return 1;
+}
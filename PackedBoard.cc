@@ -0,0 +1,132 @@
+#include "PackedBoard.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "BoardScan.h"
+
+
+namespace {
+
+constexpr char kEmptyBoardFen[] = "8/8/8/8/8/8/8/8 w - - 0 1";
+constexpr size_t kVersionOffset = 4;
+constexpr char kVersion = 1;
+constexpr uint8_t kWhiteToMoveFlag = 0x1;
+constexpr size_t kCastlingsShift = 1;
+constexpr size_t kSquares = Board::kBoardSize * Board::kBoardSize;
+
+uint16_t saturate(unsigned value) {
+  return static_cast<uint16_t>(std::min(value, 0xFFFFu));
+}
+
+}  // unnamed namespace
+
+PackedBoard PackedBoard::fromBoard(const Board& board) {
+  PackedBoard packed{};
+  uint64_t white, black;
+  board_scan::calculateColorMasks(board, white, black);
+  packed.occupancy = white | black;
+  if (board_scan::count(packed.occupancy) > kMaxFigures) {
+    throw TooManyFiguresException(board.createFEN());
+  }
+  const char* squares = board.getSquares();
+  size_t figure = 0;
+  for (uint64_t occupied = packed.occupancy; occupied; occupied &= occupied - 1, ++figure) {
+    const size_t index = board_scan::getFigureIndex(squares[__builtin_ctzll(occupied)]);
+    packed.figures[figure / 2] |= index << (4 * (figure % 2));
+  }
+  packed.flags = board.whiteToMove() ? kWhiteToMoveFlag : 0x0;
+  for (size_t castling = 0; castling < static_cast<size_t>(Castling::LAST); ++castling) {
+    if (board.canCastle(static_cast<Castling>(castling))) {
+      packed.flags |= 1 << (kCastlingsShift + castling);
+    }
+  }
+  const Square en_passant = board.getEnPassantTargetSquare();
+  packed.en_passant = en_passant ?
+      (en_passant.letter - 'a') * Board::kBoardSize + (en_passant.number - '1') : kNoEnPassant;
+  packed.halfmove_clock = saturate(board.getNumberOfHalfMoves());
+  packed.fullmove_number = saturate(board.getFullmoveNumber());
+  return packed;
+}
+
+Board PackedBoard::toBoard() const {
+  static const Board empty_board(kEmptyBoardFen);
+  if (board_scan::count(occupancy) > kMaxFigures ||
+      (en_passant != kNoEnPassant && en_passant >= kSquares)) {
+    throw InvalidPackedBoardException();
+  }
+  Board board = empty_board;
+  size_t figure = 0;
+  for (uint64_t occupied = occupancy; occupied; occupied &= occupied - 1, ++figure) {
+    const size_t index = (figures[figure / 2] >> (4 * (figure % 2))) & 0xF;
+    if (index >= board_scan::kNumberOfFigures) {
+      throw InvalidPackedBoardException();
+    }
+    const unsigned square = __builtin_ctzll(occupied);
+    board.at(board_scan::getLine(square), board_scan::getRow(square)) = board_scan::kFigures[index];
+  }
+  if ((flags & kWhiteToMoveFlag) == 0) {
+    board.changeSideToMove();
+  }
+  for (size_t castling = 0; castling < static_cast<size_t>(Castling::LAST); ++castling) {
+    if (flags & (1 << (kCastlingsShift + castling))) {
+      board.setCastling(static_cast<Castling>(castling));
+    }
+  }
+  if (en_passant != kNoEnPassant) {
+    board.setEnPassantTargetSquare(Square(board_scan::getLine(en_passant), board_scan::getRow(en_passant)));
+  }
+  board.setNumberOfHalfMoves(halfmove_clock);
+  board.setFullmoveNumber(fullmove_number);
+  return board;
+}
+
+constexpr char PackedBoardReader::kMagic[];
+
+PackedBoardReader::PackedBoardReader(const std::string& path) : file_(path) {
+  if (file_.size() < kHeaderSize ||
+      memcmp(file_.data(), kMagic, 4) != 0 ||
+      file_.data()[kVersionOffset] != kVersion ||
+      (file_.size() - kHeaderSize) % sizeof(PackedBoard) != 0) {
+    throw InvalidFileException(path);
+  }
+  size_ = (file_.size() - kHeaderSize) / sizeof(PackedBoard);
+  file_.adviseSequentialAccess();
+}
+
+PackedBoardWriter::PackedBoardWriter(const std::string& path, size_t buffer_records)
+  : path_(path), buffer_records_(std::max<size_t>(buffer_records, 1)),
+    file_(path, std::ios::binary | std::ios::trunc) {
+  const char header[PackedBoardReader::kHeaderSize] = {
+      PackedBoardReader::kMagic[0], PackedBoardReader::kMagic[1],
+      PackedBoardReader::kMagic[2], PackedBoardReader::kMagic[3], kVersion, 0, 0, 0};
+  file_.write(header, sizeof(header));
+  if (!file_) {
+    throw WriteFailedException(path);
+  }
+  buffer_.reserve(buffer_records_);
+}
+
+PackedBoardWriter::~PackedBoardWriter() {
+  try {
+    flush();
+  } catch (WriteFailedException&) {
+  }
+}
+
+void PackedBoardWriter::write(const PackedBoard& packed) {
+  buffer_.push_back(packed);
+  if (buffer_.size() == buffer_records_) {
+    flush();
+  }
+}
+
+void PackedBoardWriter::flush() {
+  file_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size() * sizeof(PackedBoard));
+  file_.flush();
+  written_ += buffer_.size();
+  buffer_.clear();
+  if (!file_) {
+    throw WriteFailedException(path_);
+  }
+}
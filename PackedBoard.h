@@ -0,0 +1,121 @@
+#ifndef PACKED_BOARD_H
+#define PACKED_BOARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "MappedFile.h"
+
+// Position in 32 bytes: occupancy mask, one nibble for each occupied square
+// and the state which FEN keeps after the figures. Stored in host byte order.
+struct PackedBoard {
+  struct InvalidPackedBoardException {};
+
+  struct TooManyFiguresException {
+    TooManyFiguresException(const std::string& f) : fen(f) {}
+    const std::string fen;
+  };
+
+  static constexpr size_t kMaxFigures = 32;
+  static constexpr uint8_t kNoEnPassant = 0xFF;
+
+  // Bit (line * 8 + row) stands for Board::at(line, row), as in board_scan.
+  uint64_t occupancy;
+  // Index in board_scan::kFigures of each occupied square in order of
+  // occupancy bits, lower nibble first.
+  uint8_t figures[kMaxFigures / 2];
+  // Bit 0: white to move, bits 1-4: castlings in order of enum Castling.
+  uint8_t flags;
+  // (line * 8 + row) of en passant target square or kNoEnPassant.
+  uint8_t en_passant;
+  // Counters above 65535 are saturated.
+  uint16_t halfmove_clock;
+  uint16_t fullmove_number;
+  uint16_t reserved;
+
+  // Throws TooManyFiguresException if |board| has more than kMaxFigures figures.
+  static PackedBoard fromBoard(const Board& board);
+  // Throws InvalidPackedBoardException for data which is not a packed board.
+  Board toBoard() const;
+};
+
+static_assert(sizeof(PackedBoard) == 32, "Packed board has to stay compact");
+
+// Read-only, memory-mapped file of packed boards: 8-byte header
+// ("CKPB", version) followed by PackedBoard records.
+class PackedBoardReader {
+ public:
+  struct InvalidFileException {
+    InvalidFileException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  static constexpr size_t kHeaderSize = 8;
+  static constexpr char kMagic[] = "CKPB";
+
+  PackedBoardReader(const std::string& path);
+
+  size_t size() const {
+    return size_;
+  }
+
+  const PackedBoard& operator[](size_t index) const {
+    return begin()[index];
+  }
+
+  const PackedBoard* begin() const {
+    return reinterpret_cast<const PackedBoard*>(file_.data() + kHeaderSize);
+  }
+
+  const PackedBoard* end() const {
+    return begin() + size_;
+  }
+
+ private:
+  MappedFile file_;
+  size_t size_{0};
+};
+
+// Appends packed boards to a new file through a buffer of |buffer_records|.
+class PackedBoardWriter {
+ public:
+  struct WriteFailedException {
+    WriteFailedException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  static constexpr size_t kDefaultBufferRecords = 1u << 16;
+
+  PackedBoardWriter(const std::string& path, size_t buffer_records = kDefaultBufferRecords);
+  // Writes buffered records, errors are ignored; call flush() to see them.
+  ~PackedBoardWriter();
+
+  PackedBoardWriter(const PackedBoardWriter&) = delete;
+  PackedBoardWriter& operator=(const PackedBoardWriter&) = delete;
+
+  void write(const PackedBoard& packed);
+
+  void write(const Board& board) {
+    write(PackedBoard::fromBoard(board));
+  }
+
+  void flush();
+
+  // Records written so far, including buffered ones.
+  size_t size() const {
+    return written_ + buffer_.size();
+  }
+
+ private:
+  const std::string path_;
+  const size_t buffer_records_;
+  std::ofstream file_;
+  std::vector<PackedBoard> buffer_;
+  size_t written_{0};
+};
+
+#endif  // PACKED_BOARD_H
@@ -0,0 +1,94 @@
+/* Component tests for PackedBoard, PackedBoardReader and PackedBoardWriter */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PackedBoard.h"
+#include "utils/Test.h"
+
+namespace {
+
+const std::vector<std::string> kFens = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w Kq - 0 1",
+  "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+  "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 17 54",
+  "8/8/8/8/8/8/8/k6K b - - 0 1"
+};
+
+TEST_PROCEDURE(PackedBoard_round_trip) {
+  TEST_START
+  for (const std::string& fen: kFens) {
+    const Board board(fen);
+    const PackedBoard packed = PackedBoard::fromBoard(board);
+    VERIFY_TRUE(packed.toBoard() == board);
+    VERIFY_EQUALS(packed.toBoard().createFEN(), fen);
+  }
+  // Counters do not fit into 16 bits.
+  const PackedBoard packed =
+      PackedBoard::fromBoard(Board("8/8/8/8/8/8/8/k6K w - - 70000 100000"));
+  VERIFY_EQUALS(packed.toBoard().createFEN(), "8/8/8/8/8/8/8/k6K w - - 65535 65535");
+  TEST_END
+}
+
+TEST_PROCEDURE(PackedBoard_rejects_invalid_data) {
+  TEST_START
+  bool exception_was_thrown = false;
+  try {
+    PackedBoard::fromBoard(Board("qqqqqqqq/qqqqqqqq/qqqqqqqq/qqqqqqqq/QQQQQQQQ/8/8/8 w - - 0 1"));
+  } catch (PackedBoard::TooManyFiguresException&) {
+    exception_was_thrown = true;
+  }
+  VERIFY_TRUE(exception_was_thrown);
+
+  PackedBoard packed = PackedBoard::fromBoard(Board(kFens[0]));
+  packed.figures[3] = 0xFF;
+  exception_was_thrown = false;
+  try {
+    packed.toBoard();
+  } catch (PackedBoard::InvalidPackedBoardException&) {
+    exception_was_thrown = true;
+  }
+  VERIFY_TRUE(exception_was_thrown);
+  TEST_END
+}
+
+TEST_PROCEDURE(PackedBoard_file_round_trip) {
+  TEST_START
+  const std::string path = "/tmp/packed_board_tests.pb";
+  {
+    // Small buffer, so that records are flushed while writing.
+    PackedBoardWriter writer(path, 2);
+    for (size_t i = 0; i < 3; ++i) {
+      for (const std::string& fen: kFens) {
+        writer.write(Board(fen));
+      }
+    }
+    VERIFY_EQUALS(writer.size(), 3 * kFens.size());
+  }
+  {
+    PackedBoardReader reader(path);
+    VERIFY_EQUALS(reader.size(), 3 * kFens.size());
+    size_t index = 0;
+    for (const PackedBoard& packed: reader) {
+      VERIFY_EQUALS(packed.toBoard().createFEN(), kFens[index % kFens.size()]);
+      ++index;
+    }
+    VERIFY_EQUALS(reader[1].toBoard().createFEN(), kFens[1]);
+  }
+  // Truncated record.
+  std::ofstream(path, std::ios::app) << "x";
+  bool exception_was_thrown = false;
+  try {
+    PackedBoardReader reader(path);
+  } catch (PackedBoardReader::InvalidFileException& e) {
+    exception_was_thrown = e.path == path;
+  }
+  VERIFY_TRUE(exception_was_thrown);
+  std::remove(path.c_str());
+  TEST_END
+}
+
+}  // unnamed namespace
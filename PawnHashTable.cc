@@ -0,0 +1,37 @@
+#include "PawnHashTable.h"
+
+
+namespace {
+
+// No position has all squares taken by pawns of both colors.
+constexpr uint64_t kEmptyMask = ~0ull;
+
+}  // unnamed namespace
+
+PawnHashTable::PawnHashTable(size_t size_in_bytes) {
+  size_t number_of_entries = 1;
+  while (number_of_entries * 2 * sizeof(Entry) <= size_in_bytes) {
+    number_of_entries *= 2;
+  }
+  entries_.assign(number_of_entries, Entry{kEmptyMask, kEmptyMask, 0});
+  mask_ = number_of_entries - 1;
+}
+
+size_t PawnHashTable::getIndex(uint64_t white_pawns, uint64_t black_pawns) const {
+  uint64_t mixed = white_pawns * 0x9E3779B97F4A7C15ull ^ black_pawns * 0xC2B2AE3D27D4EB4Full;
+  mixed ^= mixed >> 29;
+  return mixed & mask_;
+}
+
+bool PawnHashTable::probe(uint64_t white_pawns, uint64_t black_pawns, int& score) const {
+  const Entry& entry = entries_[getIndex(white_pawns, black_pawns)];
+  if (entry.white_pawns != white_pawns || entry.black_pawns != black_pawns) {
+    return false;
+  }
+  score = entry.score;
+  return true;
+}
+
+void PawnHashTable::store(uint64_t white_pawns, uint64_t black_pawns, int score) {
+  entries_[getIndex(white_pawns, black_pawns)] = Entry{white_pawns, black_pawns, score};
+}
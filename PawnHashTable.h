@@ -0,0 +1,34 @@
+#ifndef PAWN_HASH_TABLE_H
+#define PAWN_HASH_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossy table of pawn structure scores keyed by masks of white and black
+// pawns (as given by board_scan). Pawns change in few moves, so most
+// positions of a search share their entry. Not thread safe.
+class PawnHashTable {
+ public:
+  static constexpr size_t kDefaultSizeInBytes = 512u << 10;
+
+  // Number of entries is |size_in_bytes| rounded down to a power of two.
+  PawnHashTable(size_t size_in_bytes = kDefaultSizeInBytes);
+
+  bool probe(uint64_t white_pawns, uint64_t black_pawns, int& score) const;
+  void store(uint64_t white_pawns, uint64_t black_pawns, int score);
+
+ private:
+  struct Entry {
+    uint64_t white_pawns;
+    uint64_t black_pawns;
+    int score;
+  };
+
+  size_t getIndex(uint64_t white_pawns, uint64_t black_pawns) const;
+
+  std::vector<Entry> entries_;
+  size_t mask_{0};
+};
+
+#endif  // PAWN_HASH_TABLE_H
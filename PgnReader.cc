@@ -0,0 +1,284 @@
+#include "PgnReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr char kStartingFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+bool isResult(const std::string& token) {
+  return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool isTokenEnd(char c) {
+  return isspace(static_cast<unsigned char>(c)) || c == '{' || c == '(' || c == ')' ||
+         c == ';' || c == '$';
+}
+
+}  // unnamed namespace
+
+std::string PgnReader::Game::getTag(const std::string& name) const {
+  for (const auto& tag: tags) {
+    if (tag.first == name) {
+      return tag.second;
+    }
+  }
+  return "";
+}
+
+PgnReader::PgnReader(const std::string& path)
+  : file_(path), data_(reinterpret_cast<const char*>(file_.data())), size_(file_.size()) {
+  file_.adviseSequentialAccess();
+}
+
+size_t PgnReader::read(PositionCallback position_callback, GameCallback game_callback,
+                       unsigned threads) {
+  const size_t blocks = (size_ + kBlockSize - 1) / kBlockSize;
+  std::atomic<size_t> next_block{0};
+  std::atomic<size_t> games{0};
+  auto worker = [&]() {
+    for (size_t block = next_block++; block < blocks; block = next_block++) {
+      const size_t end = std::min((block + 1) * kBlockSize, size_);
+      for (size_t offset = findGameStart(block * kBlockSize); offset < end;
+           offset = findGameStart(offset)) {
+        offset = readGame(offset, position_callback, game_callback);
+        ++games;
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threads; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread: workers) {
+    thread.join();
+  }
+  return games;
+}
+
+// Game starts with a tag line which does not follow another tag line.
+bool PgnReader::isGameStart(size_t offset) const {
+  if (data_[offset] != '[') {
+    return false;
+  }
+  size_t line_end = offset;
+  while (line_end > 0) {
+    size_t line_start = line_end - 1;
+    while (line_start > 0 && data_[line_start - 1] != '\n') {
+      --line_start;
+    }
+    const char* first = std::find_if(data_ + line_start, data_ + line_end - 1,
+        [](char c) { return !isspace(static_cast<unsigned char>(c)); });
+    if (first != data_ + line_end - 1) {
+      return *first != '[';
+    }
+    line_end = line_start;
+  }
+  return true;
+}
+
+size_t PgnReader::findGameStart(size_t offset) const {
+  if (offset > 0 && data_[offset - 1] != '\n') {
+    const void* line_end = memchr(data_ + offset, '\n', size_ - offset);
+    offset = line_end ? static_cast<const char*>(line_end) - data_ + 1 : size_;
+  }
+  while (offset < size_ && !isGameStart(offset)) {
+    const void* line_end = memchr(data_ + offset, '\n', size_ - offset);
+    offset = line_end ? static_cast<const char*>(line_end) - data_ + 1 : size_;
+  }
+  return offset;
+}
+
+size_t PgnReader::readGame(size_t offset, const PositionCallback& position_callback,
+                           const GameCallback& game_callback) const {
+  Game game;
+  game.offset = offset;
+  offset = readTags(offset, game);
+  offset = readMovetext(offset, game, position_callback);
+  if (game_callback) {
+    game_callback(game);
+  }
+  return offset;
+}
+
+size_t PgnReader::readTags(size_t offset, Game& game) const {
+  while (offset < size_) {
+    const char c = data_[offset];
+    if (isspace(static_cast<unsigned char>(c))) {
+      ++offset;
+      continue;
+    }
+    if (c != '[') {
+      break;
+    }
+    const char* line_end = static_cast<const char*>(memchr(data_ + offset, '\n', size_ - offset));
+    const size_t end = line_end ? line_end - data_ : size_;
+    const std::string line(data_ + offset + 1, end - offset - 1);
+    const size_t name_end = line.find_first_of(" \t\"");
+    const size_t value_start = line.find('"');
+    const size_t value_end = line.rfind('"');
+    if (name_end != std::string::npos && value_start != std::string::npos &&
+        value_end > value_start) {
+      std::string value;
+      for (size_t i = value_start + 1; i < value_end; ++i) {
+        if (line[i] == '\\' && i + 1 < value_end) {
+          ++i;
+        }
+        value += line[i];
+      }
+      game.tags.emplace_back(line.substr(0, name_end), value);
+    }
+    offset = end;
+  }
+  return offset;
+}
+
+size_t PgnReader::readMovetext(size_t offset, Game& game,
+                               const PositionCallback& position_callback) const {
+  const std::string fen = game.getTag("FEN");
+  std::optional<Board> board;
+  try {
+    board.emplace(fen.empty() ? kStartingFen : fen);
+  } catch (Board::InvalidFENException&) {
+    game.error = "invalid FEN " + fen;
+  }
+  if (board && position_callback) {
+    position_callback(game, *board, nullptr, 0);
+  }
+  while (offset < size_) {
+    const char c = data_[offset];
+    if (isspace(static_cast<unsigned char>(c))) {
+      ++offset;
+    } else if (c == '{') {
+      const void* end = memchr(data_ + offset, '}', size_ - offset);
+      offset = end ? static_cast<const char*>(end) - data_ + 1 : size_;
+    } else if (c == ';' || (c == '%' && (offset == 0 || data_[offset - 1] == '\n'))) {
+      const void* end = memchr(data_ + offset, '\n', size_ - offset);
+      offset = end ? static_cast<const char*>(end) - data_ + 1 : size_;
+    } else if (c == '(') {
+      // Variations are skipped with comments inside them.
+      size_t depth = 0;
+      for (; offset < size_; ++offset) {
+        if (data_[offset] == '{') {
+          const void* end = memchr(data_ + offset, '}', size_ - offset);
+          offset = end ? static_cast<const char*>(end) - data_ : size_ - 1;
+        } else if (data_[offset] == '(') {
+          ++depth;
+        } else if (data_[offset] == ')' && --depth == 0) {
+          ++offset;
+          break;
+        }
+      }
+    } else if (c == '[' && (offset == 0 || data_[offset - 1] == '\n')) {
+      // Next game starts without a result.
+      break;
+    } else if (c == ')') {
+      ++offset;
+    } else {
+      size_t end = offset + 1;
+      while (end < size_ && !isTokenEnd(data_[end])) {
+        ++end;
+      }
+      std::string token(data_ + offset, end - offset);
+      offset = end;
+      if (c == '$') {
+        continue;
+      }
+      if (isResult(token)) {
+        game.result = token;
+        break;
+      }
+      // Move number, possibly glued to the move.
+      const size_t move_start = token.find_first_not_of("0123456789");
+      if (move_start != 0 && move_start != std::string::npos && token[move_start] == '.') {
+        token.erase(0, token.find_first_not_of('.', move_start));
+      }
+      if (token.empty() || !board || !game.error.empty()) {
+        continue;
+      }
+      std::optional<Move> move = findMove(*board, token);
+      if (!move) {
+        game.error = "invalid move " + token + " at ply " + std::to_string(game.plies + 1);
+        continue;
+      }
+      board = move->board;
+      ++game.plies;
+      if (position_callback) {
+        position_callback(game, *board, &*move, game.plies);
+      }
+    }
+  }
+  if (game.result.empty()) {
+    game.result = "*";
+  }
+  return offset;
+}
+
+std::optional<Move> PgnReader::findMove(const Board& board, const std::string& san) {
+  std::string text = san;
+  while (!text.empty() && strchr("+#!?", text.back())) {
+    text.pop_back();
+  }
+  if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+    const bool king_side = text.size() == 3;
+    const Castling castling = board.whiteToMove() ?
+        (king_side ? Castling::K : Castling::Q) : (king_side ? Castling::k : Castling::q);
+    MoveCalculator calculator(board);
+    for (const Move& move: calculator.calculateMovesOfFigure('K')) {
+      if (move.castling == castling) {
+        return move;
+      }
+    }
+    return std::nullopt;
+  }
+
+  char promotion = 0x0;
+  const size_t equals = text.find('=');
+  if (equals != std::string::npos) {
+    promotion = equals + 1 < text.size() ? text[equals + 1] : '?';
+    text.erase(equals);
+  } else if (text.size() > 2 && islower(static_cast<unsigned char>(text[0])) &&
+             strchr("QRBN", text.back())) {
+    promotion = text.back();
+    text.pop_back();
+  }
+  if (text.size() < 2) {
+    return std::nullopt;
+  }
+  const Square destination(text.substr(text.size() - 2));
+  if (destination.letter < 'a' || destination.letter > 'h' ||
+      destination.number < '1' || destination.number > '8') {
+    return std::nullopt;
+  }
+  const bool is_piece = strchr("KQRBN", text[0]) != nullptr;
+  const char figure = is_piece ? text[0] : 'P';
+  std::string disambiguation = text.substr(is_piece ? 1 : 0, text.size() - 2 - (is_piece ? 1 : 0));
+  disambiguation.erase(std::remove(disambiguation.begin(), disambiguation.end(), 'x'),
+                       disambiguation.end());
+
+  // Only moves of the named figure are generated, which saves most legality checks.
+  MoveCalculator calculator(board);
+  const std::vector<Move> moves = calculator.calculateMovesOfFigure(figure);
+  const Move* found = nullptr;
+  for (const Move& move: moves) {
+    if (move.castling != Castling::LAST || !(move.new_square == destination) ||
+        toupper(move.promotion) != promotion) {
+      continue;
+    }
+    const bool matches = std::all_of(disambiguation.begin(), disambiguation.end(), [&](char c) {
+      return c == move.old_square.letter || c == move.old_square.number;
+    });
+    if (matches) {
+      if (found) {
+        return std::nullopt;
+      }
+      found = &move;
+    }
+  }
+  return found ? std::optional<Move>(*found) : std::nullopt;
+}
@@ -0,0 +1,67 @@
+#ifndef PGN_READER_H
+#define PGN_READER_H
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MoveCalculator.h"
+
+// Replays games of a memory-mapped PGN file. The file is split into blocks
+// which are parsed by several threads; a game belongs to the block in which
+// its tag section starts, so every game has to start with tags. Comments,
+// variations, NAGs and escaped lines are skipped.
+class PgnReader {
+ public:
+  struct Game {
+    // Value of tag |name|, empty if there is no such tag.
+    std::string getTag(const std::string& name) const;
+
+    std::vector<std::pair<std::string, std::string>> tags;
+    // Result token ending the movetext ("1-0", "0-1", "1/2-1/2" or "*").
+    std::string result;
+    // Byte offset of the game in the file.
+    size_t offset{0};
+    size_t plies{0};
+    // Why replaying stopped, empty if all moves were played.
+    std::string error;
+  };
+
+  // Positions are reported in order within a game: the starting one with
+  // |move| equal to null, then the one after each move.
+  using PositionCallback =
+      std::function<void(const Game& game, const Board& board, const Move* move, size_t ply)>;
+  // Called when a game is finished, also for games with errors.
+  using GameCallback = std::function<void(const Game& game)>;
+
+  static constexpr size_t kBlockSize = 1u << 20;
+
+  PgnReader(const std::string& path);
+
+  // Callbacks are called concurrently from |threads| threads, games of
+  // different blocks come in no particular order. Returns number of games.
+  size_t read(PositionCallback position_callback, GameCallback game_callback,
+              unsigned threads = 1);
+
+  // Legal move on |board| described by |san| in Standard Algebraic Notation.
+  static std::optional<Move> findMove(const Board& board, const std::string& san);
+
+ private:
+  bool isGameStart(size_t offset) const;
+  size_t findGameStart(size_t offset) const;
+  // Returns offset after the parsed game.
+  size_t readGame(size_t offset, const PositionCallback& position_callback,
+                  const GameCallback& game_callback) const;
+  size_t readTags(size_t offset, Game& game) const;
+  size_t readMovetext(size_t offset, Game& game, const PositionCallback& position_callback) const;
+
+  MappedFile file_;
+  const char* data_;
+  const size_t size_;
+};
+
+#endif  // PGN_READER_H
@@ -0,0 +1,151 @@
+/* Component tests for class PgnReader */
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PgnReader.h"
+#include "utils/Test.h"
+
+namespace {
+
+const std::string kPath = "/tmp/pgn_reader_tests.pgn";
+
+const std::string kGames =
+    "[Event \"Opera\"]\n"
+    "[White \"Morphy, Paul\"]\n"
+    "[Black \"Duke Karl / Count Isouard\"]\n"
+    "[Result \"1-0\"]\n"
+    "\n"
+    "1. e4 e5 2. Nf3 d6 3. d4 Bg4 {This is a weak move.} 4. dxe5 Bxf3 5. Qxf3 dxe5\n"
+    "6. Bc4 Nf6 7. Qb3 Qe7 8. Nc3 c6 9. Bg5 b5 $6 10. Nxb5 cxb5 11. Bxb5+ Nbd7\n"
+    "12. O-O-O Rd8 13. Rxd7 Rxd7 14. Rd1 Qe6 (14... Nxd7 ; mate follows\n"
+    "15. Bxe7) 15. Bxd7+ Nxd7 16. Qb8+ Nxb8 17. Rd8# 1-0\n"
+    "\n"
+    "[Event \"Promotion\"]\n"
+    "[SetUp \"1\"]\n"
+    "[FEN \"8/P6k/8/8/8/8/8/K7 w - - 0 1\"]\n"
+    "\n"
+    "1.a8=Q Kg6 2.Qb8 1/2-1/2\n"
+    "\n"
+    "[Event \"Broken\"]\n"
+    "\n"
+    "1. e4 e5 2. Ke3 Nc6 *\n";
+
+void writeFile(const std::string& contents) {
+  std::ofstream(kPath, std::ios::binary | std::ios::trunc) << contents;
+}
+
+TEST_PROCEDURE(PgnReader_finds_moves) {
+  TEST_START
+  const Board start("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+  const auto move = PgnReader::findMove(start, "Nf3");
+  VERIFY_TRUE(move.has_value());
+  VERIFY_EQUALS(move->board.createFEN(), "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1");
+  VERIFY_TRUE(PgnReader::findMove(start, "e4!?").has_value());
+  VERIFY_FALSE(PgnReader::findMove(start, "e5").has_value());
+  VERIFY_FALSE(PgnReader::findMove(start, "Nd2").has_value());
+  VERIFY_FALSE(PgnReader::findMove(start, "Zz").has_value());
+
+  // Both knights reach d2.
+  const Board knights("4k3/8/8/8/8/1N3N2/8/R3K2R w KQ - 0 1");
+  VERIFY_FALSE(PgnReader::findMove(knights, "Nd2").has_value());
+  const auto knight_move = PgnReader::findMove(knights, "Nbd2");
+  VERIFY_TRUE(knight_move.has_value());
+  VERIFY_TRUE(knight_move->old_square == Square("b3"));
+  VERIFY_FALSE(PgnReader::findMove(knights, "N3d4").has_value());
+  const auto castling = PgnReader::findMove(knights, "O-O");
+  VERIFY_TRUE(castling.has_value());
+  VERIFY_TRUE(castling->castling == Castling::K);
+  VERIFY_TRUE(PgnReader::findMove(knights, "0-0-0").has_value());
+
+  // Both rooks reach d1.
+  const Board rooks("4k3/8/8/8/8/8/4K3/R6R w - - 0 1");
+  VERIFY_FALSE(PgnReader::findMove(rooks, "Rd1").has_value());
+  VERIFY_TRUE(PgnReader::findMove(rooks, "Rad1").has_value());
+  VERIFY_TRUE(PgnReader::findMove(rooks, "Rhxd1").has_value());
+
+  const Board promotion("1n5k/P7/8/8/8/8/8/K7 w - - 0 1");
+  const auto capture = PgnReader::findMove(promotion, "axb8=N+");
+  VERIFY_TRUE(capture.has_value());
+  VERIFY_EQUALS(capture->promotion, 'N');
+  VERIFY_TRUE(PgnReader::findMove(promotion, "a8Q").has_value());
+  VERIFY_FALSE(PgnReader::findMove(promotion, "a8").has_value());
+  TEST_END
+}
+
+TEST_PROCEDURE(PgnReader_replays_games) {
+  TEST_START
+  writeFile("% Exported games\n" + kGames);
+  PgnReader reader(kPath);
+  std::vector<PgnReader::Game> games;
+  std::vector<std::string> last_fens;
+  size_t positions = 0;
+  bool moves_match_plies = true;
+  const size_t read = reader.read(
+      [&](const PgnReader::Game&, const Board& board, const Move* move, size_t ply) {
+        moves_match_plies = moves_match_plies && (ply == 0) == (move == nullptr);
+        if (ply == 0) {
+          last_fens.push_back("");
+        }
+        last_fens.back() = board.createFEN();
+        ++positions;
+      },
+      [&](const PgnReader::Game& game) {
+        games.push_back(game);
+      });
+  VERIFY_EQUALS(read, 3u);
+  VERIFY_TRUE(moves_match_plies);
+  VERIFY_EQUALS(games.size(), 3u);
+  VERIFY_EQUALS(games[0].getTag("White"), "Morphy, Paul");
+  VERIFY_EQUALS(games[0].result, "1-0");
+  VERIFY_EQUALS(games[0].plies, 33u);
+  VERIFY_TRUE(games[0].error.empty());
+  VERIFY_EQUALS(last_fens[0], "1n1Rkb1r/p4ppp/4q3/4p1B1/4P3/8/PPP2PPP/2K5 b k - 1 17");
+  VERIFY_EQUALS(games[1].result, "1/2-1/2");
+  VERIFY_EQUALS(last_fens[1], "1Q6/8/6k1/8/8/8/8/K7 b - - 2 2");
+  VERIFY_EQUALS(games[2].result, "*");
+  VERIFY_EQUALS(games[2].plies, 2u);
+  VERIFY_EQUALS(games[2].error, "invalid move Ke3 at ply 3");
+  VERIFY_EQUALS(positions, 34u + 4u + 3u);
+  std::remove(kPath.c_str());
+  TEST_END
+}
+
+TEST_PROCEDURE(PgnReader_reads_blocks_in_parallel) {
+  TEST_START
+  // Games cross block boundaries.
+  std::string contents;
+  size_t games = 0;
+  while (contents.size() < 3 * PgnReader::kBlockSize) {
+    contents += kGames + "\n";
+    games += 3;
+  }
+  writeFile(contents);
+  PgnReader reader(kPath);
+  std::atomic<size_t> positions{0};
+  std::mutex mutex;
+  size_t finished_plies = 0;
+  size_t errors = 0;
+  const size_t read = reader.read(
+      [&](const PgnReader::Game&, const Board&, const Move*, size_t) {
+        ++positions;
+      },
+      [&](const PgnReader::Game& game) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished_plies += game.plies;
+        errors += game.error.empty() ? 0 : 1;
+      },
+      4);
+  VERIFY_EQUALS(read, games);
+  VERIFY_EQUALS(positions, games / 3 * (34u + 4u + 3u));
+  VERIFY_EQUALS(finished_plies, games / 3 * (33u + 3u + 2u));
+  VERIFY_EQUALS(errors, games / 3);
+  std::remove(kPath.c_str());
+  TEST_END
+}
+
+}  // unnamed namespace
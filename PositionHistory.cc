@@ -0,0 +1,50 @@
+#include "PositionHistory.h"
+
+#include "MoveCalculator.h"
+#include "Zobrist.h"
+
+
+void PositionHistory::push(const Board& board) {
+  hashes_.push_back(zobrist::hash(board));
+}
+
+PositionHistory::Repetitions PositionHistory::countRepetitions(
+    uint64_t hash, unsigned halfmove_clock, size_t from_index) const {
+  return countRepetitionsBefore(hashes_.size(), hash, halfmove_clock, from_index);
+}
+
+bool PositionHistory::isThreefoldRepetition(const Board& board) const {
+  if (hashes_.empty()) {
+    return false;
+  }
+  Repetitions repetitions = countRepetitionsBefore(
+      hashes_.size() - 1, hashes_.back(), board.getNumberOfHalfMoves(), 0);
+  return repetitions.total >= 2;
+}
+
+bool PositionHistory::isDrawByRule(const Board& board) const {
+  if (isThreefoldRepetition(board)) {
+    return true;
+  }
+  if (!isFiftyMoveRule(board)) {
+    return false;
+  }
+  MoveCalculator calculator(board);
+  return !calculator.calculateAllMoves().empty() || !calculator.isCheck();
+}
+
+PositionHistory::Repetitions PositionHistory::countRepetitionsBefore(
+    size_t end, uint64_t hash, unsigned halfmove_clock, size_t from_index) const {
+  Repetitions result{0, 0};
+  // Positions with the same side to move only, so every second one is compared.
+  for (size_t distance = 2; distance <= halfmove_clock && distance <= end; distance += 2) {
+    const size_t index = end - distance;
+    if (hashes_[index] == hash) {
+      ++result.total;
+      if (index >= from_index) {
+        ++result.since_index;
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,70 @@
+#ifndef POSITION_HISTORY_H
+#define POSITION_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+// Stack of zobrist hashes of positions played so far, the current position
+// last. Used by the game loop and extended by the search along its path.
+class PositionHistory {
+ public:
+  static constexpr unsigned kFiftyMoveRuleHalfMoves = 100;
+
+  void push(const Board& board);
+  void push(uint64_t hash) {
+    hashes_.push_back(hash);
+  }
+
+  void pop() {
+    hashes_.pop_back();
+  }
+
+  void clear() {
+    hashes_.clear();
+  }
+
+  size_t size() const {
+    return hashes_.size();
+  }
+
+  bool empty() const {
+    return hashes_.empty();
+  }
+
+  uint64_t back() const {
+    return hashes_.back();
+  }
+
+  struct Repetitions {
+    unsigned total;
+    // Occurrences at |from_index| or later.
+    unsigned since_index;
+  };
+
+  // Counts occurrences of a position following the last one in the history.
+  // Only the last |halfmove_clock| positions are looked at, as earlier ones
+  // are separated by an irreversible move.
+  Repetitions countRepetitions(uint64_t hash, unsigned halfmove_clock, size_t from_index = 0) const;
+
+  // Current (last) position occurred at least twice before.
+  bool isThreefoldRepetition(const Board& board) const;
+
+  static bool isFiftyMoveRule(const Board& board) {
+    return board.getNumberOfHalfMoves() >= kFiftyMoveRuleHalfMoves;
+  }
+
+  // Game with the last position |board| is drawn by threefold repetition
+  // or by the fifty-move rule (unless |board| is checkmate).
+  bool isDrawByRule(const Board& board) const;
+
+ private:
+  Repetitions countRepetitionsBefore(size_t end, uint64_t hash, unsigned halfmove_clock,
+                                     size_t from_index) const;
+
+  std::vector<uint64_t> hashes_;
+};
+
+#endif  // POSITION_HISTORY_H
@@ -0,0 +1,61 @@
+/* Component tests for class PositionHistory */
+
+#include <string>
+#include <vector>
+
+#include "PositionHistory.h"
+#include "Zobrist.h"
+#include "utils/Test.h"
+
+namespace {
+
+PositionHistory createHistory(const std::vector<std::string>& fens) {
+  PositionHistory history;
+  for (const auto& fen: fens) {
+    history.push(Board(fen));
+  }
+  return history;
+}
+
+TEST_PROCEDURE(PositionHistory_threefold_repetition) {
+  TEST_START
+  const std::vector<std::string> fens = {
+    "4k3/8/8/8/8/8/8/4K2R w K - 0 1",
+    "4k3/8/8/8/8/8/8/5K1R b - - 1 1",
+    "3k4/8/8/8/8/8/8/5K1R w - - 2 2",
+    "3k4/8/8/8/8/8/8/4K2R b - - 3 2",
+    "4k3/8/8/8/8/8/8/4K2R w - - 4 3",
+    "4k3/8/8/8/8/8/8/5K1R b - - 5 3",
+    "3k4/8/8/8/8/8/8/5K1R w - - 6 4",
+    "3k4/8/8/8/8/8/8/4K2R b - - 7 4",
+    "4k3/8/8/8/8/8/8/4K2R w - - 8 5"
+  };
+  // The first position differs by castling rights.
+  PositionHistory history = createHistory(fens);
+  VERIFY_FALSE(history.isThreefoldRepetition(Board(fens.back())));
+  const Board repeated("4k3/8/8/8/8/8/8/5K1R b - - 9 5");
+  history.push(repeated);
+  VERIFY_TRUE(history.isThreefoldRepetition(repeated));
+  VERIFY_TRUE(history.isDrawByRule(repeated));
+  // Earlier positions are not looked at past the last irreversible move.
+  VERIFY_FALSE(history.isThreefoldRepetition(Board("4k3/8/8/8/8/8/8/5K1R b - - 3 5")));
+
+  const PositionHistory::Repetitions repetitions = history.countRepetitions(
+      zobrist::hash(Board("3k4/8/8/8/8/8/8/5K1R w - - 10 6")), 10, 5);
+  VERIFY_EQUALS(repetitions.total, 2u);
+  VERIFY_EQUALS(repetitions.since_index, 1u);
+  TEST_END
+}
+
+TEST_PROCEDURE(PositionHistory_fifty_move_rule) {
+  TEST_START
+  PositionHistory history;
+  VERIFY_FALSE(PositionHistory::isFiftyMoveRule(Board("4k3/8/8/8/8/8/8/4K2R w - - 99 80")));
+  VERIFY_TRUE(PositionHistory::isFiftyMoveRule(Board("4k3/8/8/8/8/8/8/4K2R w - - 100 80")));
+  VERIFY_TRUE(history.isDrawByRule(Board("4k3/8/8/8/8/8/8/4K2R w - - 100 80")));
+  // Checkmate given with the hundredth half move stands.
+  VERIFY_FALSE(history.isDrawByRule(Board("R3k3/8/4K3/8/8/8/8/8 b - - 100 80")));
+  TEST_END
+}
+
+}  // unnamed namespace
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "PackedBoard.h"
+#include "PgnReader.h"
+
+namespace {
+
+struct ReplaySettings {
+  std::string input_path;
+  std::string output_path;
+  unsigned threads{std::max(std::thread::hardware_concurrency(), 1u)};
+};
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [options] <input.pgn>" << std::endl
+            << "  --threads N    games replayed at once (all cores)" << std::endl
+            << "  --output FILE  packed positions of all games (none)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], ReplaySettings& settings) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option.compare(0, 2, "--") != 0) {
+      if (!settings.input_path.empty()) {
+        return false;
+      }
+      settings.input_path = option;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::istringstream value(argv[++i]);
+    if (option == "--threads") {
+      value >> settings.threads;
+      if (!value || settings.threads == 0) {
+        return false;
+      }
+    } else if (option == "--output") {
+      settings.output_path = value.str();
+    } else {
+      return false;
+    }
+  }
+  return !settings.input_path.empty();
+}
+
+int replay(const ReplaySettings& settings) {
+  const auto start = std::chrono::steady_clock::now();
+  PgnReader reader(settings.input_path);
+  std::unique_ptr<PackedBoardWriter> writer;
+  if (!settings.output_path.empty()) {
+    writer = std::make_unique<PackedBoardWriter>(settings.output_path);
+  }
+  std::mutex mutex;
+  std::atomic<size_t> positions{0};
+  size_t errors = 0;
+  const size_t games = reader.read(
+      [&](const PgnReader::Game&, const Board& board, const Move*, size_t) {
+        ++positions;
+        if (writer) {
+          const PackedBoard packed = PackedBoard::fromBoard(board);
+          std::lock_guard<std::mutex> lock(mutex);
+          writer->write(packed);
+        }
+      },
+      [&](const PgnReader::Game& game) {
+        if (!game.error.empty()) {
+          std::lock_guard<std::mutex> lock(mutex);
+          std::cerr << settings.input_path << ":" << game.offset << ": " << game.error << std::endl;
+          ++errors;
+        }
+      },
+      settings.threads);
+  if (writer) {
+    writer->flush();
+  }
+  const auto time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  std::cerr << "Replayed " << games << " games (" << positions << " positions, "
+            << errors << " with errors) in " << time_ms << " ms" << std::endl;
+  return 0;
+}
+
+}  // unnamed namespace
+
+int main(int argc, char* argv[]) {
+  ReplaySettings settings;
+  if (!parseArguments(argc, argv, settings)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  try {
+    return replay(settings);
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+  } catch (PackedBoardWriter::WriteFailedException& e) {
+    std::cerr << "Cannot write " << e.path << std::endl;
+  }
+  return 1;
+}
@@ -0,0 +1,106 @@
+#include "SearchTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "MappedFile.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'C', 'K', 'S', 'T'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 8;
+constexpr auto kFlushInterval = std::chrono::milliseconds(10);
+
+size_t roundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // unnamed namespace
+
+
+SearchTrace::SearchTrace(const std::string& path, unsigned sample_rate, size_t buffer_records)
+  : file_(path, std::ios::binary | std::ios::trunc),
+    sample_rate_(sample_rate > 0 ? sample_rate : 1),
+    buffer_(roundUpToPowerOfTwo(buffer_records > 1 ? buffer_records : 2)),
+    mask_(buffer_.size() - 1) {
+  if (!file_) {
+    throw OpenFailedException(path);
+  }
+  file_.write(kMagic, sizeof(kMagic));
+  file_.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+  flush_thread_ = std::thread(&SearchTrace::flushLoop, this);
+}
+
+SearchTrace::~SearchTrace() {
+  stop_ = true;
+  flush_thread_.join();
+  flush();
+}
+
+bool SearchTrace::startSearch() {
+  return searches_++ % sample_rate_ == 0;
+}
+
+void SearchTrace::add(const Record& record) {
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == buffer_.size()) {
+    dropped_records_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer_[head & mask_] = record;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+void SearchTrace::flushLoop() {
+  while (!stop_) {
+    std::this_thread::sleep_for(kFlushInterval);
+    flush();
+  }
+}
+
+void SearchTrace::flush() {
+  const size_t head = head_.load(std::memory_order_acquire);
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  while (tail != head) {
+    // Contiguous part of the buffer up to its end or to |head|.
+    const size_t begin = tail & mask_;
+    const size_t count = std::min(head - tail, buffer_.size() - begin);
+    file_.write(reinterpret_cast<const char*>(&buffer_[begin]), count * sizeof(Record));
+    tail += count;
+    tail_.store(tail, std::memory_order_release);
+  }
+  const unsigned long long dropped = dropped_records_.load(std::memory_order_relaxed);
+  if (dropped != reported_dropped_records_) {
+    const unsigned long long lost = dropped - reported_dropped_records_;
+    Record record{};
+    record.event = Event::DROPPED;
+    record.children = static_cast<uint16_t>(lost & 0xffff);
+    record.move = static_cast<uint16_t>(std::min(lost >> 16, 0xffffull));
+    file_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    reported_dropped_records_ = dropped;
+  }
+  file_.flush();
+}
+
+std::vector<SearchTrace::Record> SearchTrace::readFile(const std::string& path) {
+  MappedFile file(path);
+  if (file.size() < kHeaderSize || memcmp(file.data(), kMagic, sizeof(kMagic)) != 0) {
+    throw InvalidTraceException(path);
+  }
+  uint32_t version;
+  memcpy(&version, file.data() + sizeof(kMagic), sizeof(version));
+  if (version != kVersion || (file.size() - kHeaderSize) % sizeof(Record) != 0) {
+    throw InvalidTraceException(path);
+  }
+  std::vector<Record> records((file.size() - kHeaderSize) / sizeof(Record));
+  if (!records.empty()) {
+    memcpy(records.data(), file.data() + kHeaderSize, records.size() * sizeof(Record));
+  }
+  return records;
+}
@@ -0,0 +1,112 @@
+#ifndef SEARCH_TRACE_H
+#define SEARCH_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary log of search tree visits. The searching thread appends records to
+// a lock-free single-producer ring buffer, a background thread flushes it to
+// disk. Records are dropped (and counted) rather than blocking the search
+// when the buffer is full. Only every n-th search is recorded, so tracing
+// may stay on with a small sampling rate.
+//
+// File layout: 8-byte header ("CKST", version) followed by 16-byte records
+// in host byte order. Node records are written in postorder, so the tree
+// shape can be rebuilt from ply numbers alone.
+class SearchTrace {
+ public:
+  struct OpenFailedException {
+    OpenFailedException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  struct InvalidTraceException {
+    InvalidTraceException(const std::string& p) : path(p) {}
+    const std::string path;
+  };
+
+  enum class Event : uint8_t {
+    SEARCH_START,
+    ITERATION_START,
+    // Leaf expanded in this visit, |children| moves were generated.
+    EXPANSION,
+    // Already expanded node, searched through its children.
+    VISIT,
+    // Mate, draw or table result, not searched further.
+    TERMINAL,
+    SEARCH_END,
+    // Records lost because the buffer was full, count in |children| and |move|.
+    DROPPED
+  };
+
+  enum class Cutoff : uint8_t {
+    NONE,
+    TIME,
+    NODES,
+    MATE,
+    BITBASE,
+    DRAW,
+    // Search of the children stopped as the score fell outside of the window.
+    BETA
+  };
+
+  static constexpr int16_t kNoBound = INT16_MIN;
+
+  struct Record {
+    Event event;
+    uint8_t ply;
+    // Polyglot encoding as in OpeningBook::encodeMove, 0 for the root.
+    uint16_t move;
+    uint16_t children;
+    Cutoff cutoff;
+    uint8_t reserved;
+    int16_t score;
+    int16_t moves_to_mate;
+    // Search window of the visit, kNoBound when open.
+    int16_t alpha;
+    int16_t beta;
+  };
+  static_assert(sizeof(Record) == 16, "Trace records have to stay compact");
+
+  // |sample_rate| n records every n-th search; 1 records all of them.
+  SearchTrace(const std::string& path, unsigned sample_rate = 1,
+              size_t buffer_records = 1u << 20);
+  ~SearchTrace();
+
+  SearchTrace(const SearchTrace&) = delete;
+  SearchTrace& operator=(const SearchTrace&) = delete;
+
+  // Returns whether the search that is starting should be recorded.
+  bool startSearch();
+  // Called only by the searching thread, at most one per trace.
+  void add(const Record& record);
+
+  unsigned long long getDroppedRecords() const {
+    return dropped_records_;
+  }
+
+  static std::vector<Record> readFile(const std::string& path);
+
+ private:
+  void flushLoop();
+  void flush();
+
+  std::ofstream file_;
+  const unsigned sample_rate_;
+  unsigned long long searches_{0ull};
+  std::vector<Record> buffer_;
+  const size_t mask_;
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<unsigned long long> dropped_records_{0ull};
+  unsigned long long reported_dropped_records_{0ull};
+  std::atomic<bool> stop_{false};
+  std::thread flush_thread_;
+};
+
+#endif  // SEARCH_TRACE_H
@@ -0,0 +1,116 @@
+#include <pthread.h>
+#include <signal.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "AnalysisServer.h"
+
+namespace {
+
+void printUsage(const char* program) {
+  const AnalysisServer::Settings defaults;
+  std::cerr << "Usage: " << program << " [options] <socket path>" << std::endl
+            << "  --engines N     engines in the pool (" << defaults.engines << ")" << std::endl
+            << "  --depth N       default search depth (" << defaults.depth << ")" << std::endl
+            << "  --time MS       default time per request (" << defaults.time_ms << ")" << std::endl
+            << "  --max-time MS   longest time per request (" << defaults.max_time_ms << ")" << std::endl
+            << "  --queue N       waiting requests before new ones are rejected ("
+            << defaults.max_queue << ")" << std::endl
+            << "  --network FILE  evaluation network (material)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], AnalysisServer::Settings& settings,
+                    std::string& socket_path, std::string& network_path) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option.compare(0, 2, "--") != 0) {
+      if (!socket_path.empty()) {
+        return false;
+      }
+      socket_path = option;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::istringstream value(argv[++i]);
+    if (option == "--engines") {
+      value >> settings.engines;
+    } else if (option == "--depth") {
+      value >> settings.depth;
+    } else if (option == "--time") {
+      value >> settings.time_ms;
+    } else if (option == "--max-time") {
+      value >> settings.max_time_ms;
+    } else if (option == "--queue") {
+      value >> settings.max_queue;
+    } else if (option == "--network") {
+      value >> network_path;
+    } else {
+      return false;
+    }
+    if (!value) {
+      return false;
+    }
+  }
+  return !socket_path.empty() && settings.engines > 0 && settings.depth > 0;
+}
+
+}  // unnamed namespace
+
+// Serves analysis requests on a Unix socket until SIGINT or SIGTERM,
+// see AnalysisServer.h for the protocol.
+int main(int argc, char* argv[]) {
+  AnalysisServer::Settings settings;
+  std::string socket_path;
+  std::string network_path;
+  if (!parseArguments(argc, argv, settings, socket_path, network_path)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  try {
+    if (!network_path.empty()) {
+      settings.network = std::make_shared<Nnue>(network_path);
+    }
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+    return 1;
+  } catch (Nnue::InvalidNetworkException& e) {
+    std::cerr << "Invalid network " << e.path << std::endl;
+    return 1;
+  }
+
+  // Signals are taken by one thread, all threads started later inherit the mask.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  AnalysisServer server(settings);
+  std::thread signal_thread([&server, &signals]() {
+    int signal;
+    sigwait(&signals, &signal);
+    server.stop();
+  });
+  int result = 0;
+  try {
+    std::cerr << "Serving on " << socket_path << std::endl;
+    server.serve(socket_path);
+  } catch (AnalysisServer::SocketException& e) {
+    std::cerr << "Cannot listen on " << e.path << ": " << strerror(e.error) << std::endl;
+    result = 1;
+  }
+  pthread_kill(signal_thread.native_handle(), SIGTERM);
+  signal_thread.join();
+
+  const AnalysisServer::Statistics statistics = server.getStatistics();
+  std::cerr << "Answered " << statistics.requests << " requests, rejected "
+            << statistics.rejected << ", latency p50 " << statistics.p50_ms << " ms, p99 "
+            << statistics.p99_ms << " ms, max " << statistics.max_ms << " ms" << std::endl;
+  return result;
+}
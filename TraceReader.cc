@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "SearchTrace.h"
+
+namespace {
+
+struct PlyStatistics {
+  unsigned long long nodes{0ull};
+  unsigned long long expansions{0ull};
+  unsigned long long generated_moves{0ull};
+  unsigned long long terminals{0ull};
+  unsigned long long cutoffs{0ull};
+};
+
+struct SearchStatistics {
+  unsigned iterations{0};
+  unsigned long long records{0ull};
+  unsigned long long mates{0ull};
+  unsigned long long bitbase_hits{0ull};
+  unsigned long long draws{0ull};
+  SearchTrace::Cutoff cutoff{SearchTrace::Cutoff::NONE};
+  int score{0};
+  int moves_to_mate{0};
+  std::vector<PlyStatistics> plies;
+};
+
+const char* toString(SearchTrace::Cutoff cutoff) {
+  switch (cutoff) {
+    case SearchTrace::Cutoff::NONE:
+      return "none";
+    case SearchTrace::Cutoff::TIME:
+      return "time";
+    case SearchTrace::Cutoff::NODES:
+      return "nodes";
+    case SearchTrace::Cutoff::MATE:
+      return "mate";
+    case SearchTrace::Cutoff::BITBASE:
+      return "bitbase";
+    case SearchTrace::Cutoff::DRAW:
+      return "draw";
+    case SearchTrace::Cutoff::BETA:
+      return "beta";
+  }
+  return "unknown";
+}
+
+void printSearch(size_t index, const SearchStatistics& search) {
+  std::cout << "Search " << index << ": " << search.iterations << " iterations, "
+            << search.records << " records, stopped by " << toString(search.cutoff)
+            << ", score " << search.score;
+  if (search.moves_to_mate != 0) {
+    std::cout << ", moves to mate " << search.moves_to_mate;
+  }
+  std::cout << std::endl
+            << "  mates " << search.mates << ", draws " << search.draws
+            << ", bitbase hits " << search.bitbase_hits << std::endl
+            << "  ply        nodes   expansions    branching    terminals      cutoffs" << std::endl;
+  for (size_t ply = 0; ply < search.plies.size(); ++ply) {
+    const PlyStatistics& statistics = search.plies[ply];
+    const double branching = statistics.expansions > 0 ?
+        static_cast<double>(statistics.generated_moves) / statistics.expansions : 0.0;
+    std::cout << std::setw(5) << ply
+              << std::setw(13) << statistics.nodes
+              << std::setw(13) << statistics.expansions
+              << std::setw(13) << std::fixed << std::setprecision(2) << branching
+              << std::setw(13) << statistics.terminals
+              << std::setw(13) << statistics.cutoffs << std::endl;
+  }
+}
+
+}  // unnamed namespace
+
+// Rebuilds tree shape statistics of every search recorded in a trace file.
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <trace file>" << std::endl;
+    return 1;
+  }
+  std::vector<SearchTrace::Record> records;
+  try {
+    records = SearchTrace::readFile(argv[1]);
+  } catch (MappedFile::MappingFailedException& e) {
+    std::cerr << "Cannot open " << e.path << std::endl;
+    return 1;
+  } catch (SearchTrace::InvalidTraceException& e) {
+    std::cerr << "Invalid trace " << e.path << std::endl;
+    return 1;
+  }
+
+  size_t searches = 0;
+  unsigned long long dropped_records = 0ull;
+  SearchStatistics search;
+  for (const SearchTrace::Record& record: records) {
+    if (record.event == SearchTrace::Event::DROPPED) {
+      dropped_records += (static_cast<unsigned long long>(record.move) << 16) + record.children;
+      continue;
+    }
+    ++search.records;
+    if (record.event == SearchTrace::Event::SEARCH_START) {
+      search = SearchStatistics();
+      search.records = 1;
+      continue;
+    }
+    if (record.event == SearchTrace::Event::ITERATION_START) {
+      ++search.iterations;
+      continue;
+    }
+    if (record.event == SearchTrace::Event::SEARCH_END) {
+      search.cutoff = record.cutoff;
+      search.score = record.score;
+      search.moves_to_mate = record.moves_to_mate;
+      printSearch(++searches, search);
+      continue;
+    }
+    if (search.plies.size() <= record.ply) {
+      search.plies.resize(record.ply + 1);
+    }
+    PlyStatistics& ply = search.plies[record.ply];
+    ++ply.nodes;
+    if (record.cutoff == SearchTrace::Cutoff::BETA) {
+      ++ply.cutoffs;
+    }
+    if (record.event == SearchTrace::Event::EXPANSION) {
+      ++ply.expansions;
+      ply.generated_moves += record.children;
+    } else if (record.event == SearchTrace::Event::TERMINAL) {
+      ++ply.terminals;
+      if (record.cutoff == SearchTrace::Cutoff::MATE) {
+        ++search.mates;
+      } else if (record.cutoff == SearchTrace::Cutoff::DRAW) {
+        ++search.draws;
+      } else {
+        ++search.bitbase_hits;
+      }
+    }
+  }
+  std::cout << searches << " searches, " << records.size() << " records, "
+            << dropped_records << " dropped" << std::endl;
+  return dropped_records > 0 ? 2 : 0;
+}
@@ -0,0 +1,341 @@
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Board.h"
+#include "Engine.h"
+#include "MoveCalculator.h"
+#include "OpeningBook.h"
+
+namespace {
+
+constexpr char kInitialFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+constexpr unsigned kMaxDepth = 64;
+constexpr unsigned kInfiniteTimeMs = 24 * 60 * 60 * 1000;
+constexpr unsigned kDefaultMovesToGo = 30;
+constexpr unsigned kMoveOverheadMs = 50;
+constexpr unsigned kMinimalTimeForMoveMs = 10;
+
+std::string toUciMove(const Move& move) {
+  std::string result{move.old_square.letter, move.old_square.number,
+                     move.new_square.letter, move.new_square.number};
+  if (move.promotion) {
+    result += static_cast<char>(tolower(move.promotion));
+  }
+  return result;
+}
+
+// Plays |uci_move| on |board|. Returns false if it is not a legal move.
+bool makeMove(Board& board, const std::string& uci_move) {
+  MoveCalculator calculator(board);
+  for (const Move& move: calculator.calculateAllMoves()) {
+    if (toUciMove(move) == uci_move) {
+      board = move.board;
+      return true;
+    }
+  }
+  return false;
+}
+
+class UciFrontEnd {
+ public:
+  UciFrontEnd(std::istream& input, std::ostream& output)
+    : input_(input), output_(output), board_(kInitialFen) {
+    history_.push(board_);
+    createEngine();
+  }
+
+  void run();
+
+ private:
+  void createEngine();
+  void send(const std::string& message);
+  void handleSetOption(std::istringstream& command);
+  void handlePosition(std::istringstream& command);
+  void handleGo(std::istringstream& command);
+  void stopSearch();
+  void search(Board board, PositionHistory history, bool infinite);
+  void onIteration(const Engine::IterationStats& stats, bool white_to_move);
+
+  std::istream& input_;
+  std::ostream& output_;
+  std::mutex output_mutex_;
+  std::unique_ptr<Engine> engine_;
+  std::shared_ptr<const OpeningBook> opening_book_;
+  std::shared_ptr<SearchTrace> search_trace_;
+  std::shared_ptr<const Nnue> network_;
+  unsigned trace_sample_rate_{1};
+  unsigned multi_pv_{1};
+  Board board_;
+  PositionHistory history_;
+  std::thread search_thread_;
+  // Stop can come before the engine has started the search, so it is
+  // repeated after every iteration.
+  std::atomic<bool> stop_requested_{false};
+  std::mutex stop_mutex_;
+  std::condition_variable stop_condition_;
+};
+
+void UciFrontEnd::createEngine() {
+  engine_ = std::make_unique<Engine>(kMaxDepth, kInfiniteTimeMs);
+  if (opening_book_) {
+    engine_->setOpeningBook(opening_book_);
+  }
+  if (search_trace_) {
+    engine_->setSearchTrace(search_trace_);
+  }
+  if (network_) {
+    engine_->setNetwork(network_);
+  }
+  engine_->setMultiPV(multi_pv_);
+}
+
+void UciFrontEnd::send(const std::string& message) {
+  std::lock_guard<std::mutex> lock(output_mutex_);
+  output_ << message << std::endl;
+}
+
+void UciFrontEnd::handleSetOption(std::istringstream& command) {
+  std::string token;
+  std::string name;
+  std::string value;
+  command >> token;  // "name"
+  while (command >> token && token != "value") {
+    name += (name.empty() ? "" : " ") + token;
+  }
+  std::getline(command >> std::ws, value);
+  if (name == "BookFile") {
+    try {
+      opening_book_.reset();
+      if (!value.empty() && value != "<empty>") {
+        opening_book_ = std::make_shared<OpeningBook>(value);
+      }
+      engine_->setOpeningBook(opening_book_);
+    } catch (MappedFile::MappingFailedException& e) {
+      send("info string Cannot open opening book " + e.path);
+    } catch (OpeningBook::InvalidBookException& e) {
+      send("info string Invalid opening book " + e.path);
+    }
+  } else if (name == "EvalFile") {
+    try {
+      network_.reset();
+      if (!value.empty() && value != "<empty>") {
+        network_ = std::make_shared<Nnue>(value);
+      }
+      engine_->setNetwork(network_);
+    } catch (MappedFile::MappingFailedException& e) {
+      send("info string Cannot open network " + e.path);
+    } catch (Nnue::InvalidNetworkException& e) {
+      send("info string Invalid network " + e.path);
+    }
+  } else if (name == "MultiPV") {
+    std::istringstream(value) >> multi_pv_;
+    engine_->setMultiPV(multi_pv_);
+  } else if (name == "TraceSampleRate") {
+    std::istringstream(value) >> trace_sample_rate_;
+  } else if (name == "TraceFile") {
+    try {
+      search_trace_.reset();
+      if (!value.empty() && value != "<empty>") {
+        search_trace_ = std::make_shared<SearchTrace>(value, trace_sample_rate_);
+      }
+      engine_->setSearchTrace(search_trace_);
+    } catch (SearchTrace::OpenFailedException& e) {
+      send("info string Cannot open search trace " + e.path);
+    }
+  }
+}
+
+void UciFrontEnd::handlePosition(std::istringstream& command) {
+  std::string token;
+  command >> token;
+  std::string fen;
+  if (token == "startpos") {
+    fen = kInitialFen;
+    command >> token;
+  } else if (token == "fen") {
+    while (command >> token && token != "moves") {
+      fen += (fen.empty() ? "" : " ") + token;
+    }
+  } else {
+    return;
+  }
+  try {
+    board_ = Board(fen);
+    history_.clear();
+    history_.push(board_);
+  } catch (Board::InvalidFENException&) {
+    send("info string Invalid FEN " + fen);
+    return;
+  }
+  if (token != "moves") {
+    return;
+  }
+  while (command >> token) {
+    if (makeMove(board_, token) == false) {
+      send("info string Illegal move " + token);
+      return;
+    }
+    history_.push(board_);
+  }
+}
+
+void UciFrontEnd::handleGo(std::istringstream& command) {
+  stopSearch();
+  unsigned depth = kMaxDepth;
+  unsigned long long nodes = 0ull;
+  long movetime = -1;
+  long time_left[2] = {-1, -1};
+  long increment[2] = {0, 0};
+  unsigned moves_to_go = kDefaultMovesToGo;
+  bool infinite = false;
+  std::string token;
+  while (command >> token) {
+    if (token == "depth") {
+      command >> depth;
+    } else if (token == "nodes") {
+      command >> nodes;
+    } else if (token == "movetime") {
+      command >> movetime;
+    } else if (token == "wtime") {
+      command >> time_left[0];
+    } else if (token == "btime") {
+      command >> time_left[1];
+    } else if (token == "winc") {
+      command >> increment[0];
+    } else if (token == "binc") {
+      command >> increment[1];
+    } else if (token == "movestogo") {
+      command >> moves_to_go;
+    } else if (token == "infinite") {
+      infinite = true;
+    }
+  }
+
+  long time_for_move = kInfiniteTimeMs;
+  const size_t side = board_.whiteToMove() ? 0 : 1;
+  if (movetime >= 0) {
+    time_for_move = movetime;
+  } else if (!infinite && time_left[side] >= 0) {
+    time_for_move = time_left[side] / std::max(moves_to_go, 1u) + increment[side] * 3 / 4;
+    time_for_move = std::min(time_for_move, time_left[side] - static_cast<long>(kMoveOverheadMs));
+  }
+  time_for_move = std::max(time_for_move, static_cast<long>(kMinimalTimeForMoveMs));
+
+  engine_->setDepth(depth);
+  engine_->setNodesLimit(nodes);
+  engine_->setTimeForMove(static_cast<unsigned>(time_for_move));
+  stop_requested_ = false;
+  search_thread_ = std::thread(&UciFrontEnd::search, this, board_, history_, infinite);
+}
+
+void UciFrontEnd::stopSearch() {
+  if (search_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(stop_mutex_);
+      stop_requested_ = true;
+    }
+    stop_condition_.notify_all();
+    engine_->stop();
+    search_thread_.join();
+  }
+}
+
+void UciFrontEnd::onIteration(const Engine::IterationStats& stats, bool white_to_move) {
+  if (stop_requested_) {
+    engine_->stop();
+  }
+  // One info line for each line, "multipv" is given only if there are more lines.
+  for (size_t i = 0; i < stats.lines.size(); ++i) {
+    const Engine::Line& line = stats.lines[i];
+    std::stringstream info;
+    info << "info depth " << stats.depth << " seldepth " << stats.selective_depth;
+    if (stats.lines.size() > 1) {
+      info << " multipv " << i + 1;
+    }
+    info << " nodes " << stats.nodes << " nps " << stats.nodes_per_second
+         << " time " << stats.time_ms << " score ";
+    const int sign = white_to_move ? 1 : -1;
+    if (line.moves_to_mate != 0) {
+      // moves_to_mate counts plies plus one, UCI wants moves.
+      info << "mate " << sign * (line.moves_to_mate > 0 ? 1 : -1) * (std::abs(line.moves_to_mate) / 2);
+    } else {
+      info << "cp " << sign * line.score;
+    }
+    if (!line.principal_variation.empty()) {
+      info << " pv";
+      for (const Move& move: line.principal_variation) {
+        info << " " << toUciMove(move);
+      }
+    }
+    send(info.str());
+  }
+}
+
+void UciFrontEnd::search(Board board, PositionHistory history, bool infinite) {
+  const bool white_to_move = board.whiteToMove();
+  engine_->setIterationCallback([this, white_to_move](Engine::IterationStats stats) {
+    onIteration(stats, white_to_move);
+  });
+  std::string best_move = "0000";
+  try {
+    best_move = toUciMove(engine_->calculateBestMove(board, history));
+  } catch (Engine::NoValidMoveException&) {
+  }
+  if (infinite) {
+    // In infinite mode best move may be sent only after "stop".
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stop_condition_.wait(lock, [this] { return stop_requested_.load(); });
+  }
+  send("bestmove " + best_move);
+}
+
+void UciFrontEnd::run() {
+  std::string line;
+  while (std::getline(input_, line)) {
+    std::istringstream command(line);
+    std::string token;
+    command >> token;
+    if (token == "uci") {
+      send("id name chess2.0");
+      send("id author cekaem");
+      send("option name BookFile type string default <empty>");
+      send("option name EvalFile type string default <empty>");
+      send("option name TraceFile type string default <empty>");
+      send("option name TraceSampleRate type spin default 1 min 1 max 1000000");
+      send("option name MultiPV type spin default 1 min 1 max 256");
+      send("uciok");
+    } else if (token == "isready") {
+      send("readyok");
+    } else if (token == "setoption") {
+      stopSearch();
+      handleSetOption(command);
+    } else if (token == "ucinewgame") {
+      stopSearch();
+      createEngine();
+    } else if (token == "position") {
+      stopSearch();
+      handlePosition(command);
+    } else if (token == "go") {
+      handleGo(command);
+    } else if (token == "stop") {
+      stopSearch();
+    } else if (token == "quit") {
+      break;
+    }
+  }
+  stopSearch();
+}
+
+}  // unnamed namespace
+
+int main() {
+  UciFrontEnd front_end(std::cin, std::cout);
+  front_end.run();
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include "Zobrist.h"
+
+#include <array>
+#include <cstring>
+
+
+namespace {
+
+// splitmix64 with a fixed seed gives the same keys on every build.
+constexpr std::array<uint64_t, zobrist::kNumberOfKeys> generateKeys() {
+  std::array<uint64_t, zobrist::kNumberOfKeys> keys{};
+  uint64_t state = 0x2545F4914F6CDD1Dull;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    keys[i] = z ^ (z >> 31);
+  }
+  return keys;
+}
+
+constexpr std::array<uint64_t, zobrist::kNumberOfKeys> kKeys = generateKeys();
+
+// Polyglot piece kinds: black pawn, white pawn, black knight, ...
+size_t getPieceKind(char figure) {
+  switch (figure) {
+    case 'p': return 0;
+    case 'P': return 1;
+    case 'n': return 2;
+    case 'N': return 3;
+    case 'b': return 4;
+    case 'B': return 5;
+    case 'r': return 6;
+    case 'R': return 7;
+    case 'q': return 8;
+    case 'Q': return 9;
+    case 'k': return 10;
+    case 'K': return 11;
+    default:
+      assert(!"Unknown figure");
+      break;
+  }
+  return 0;
+}
+
+}  // unnamed namespace
+
+
+namespace zobrist {
+
+uint64_t key(size_t index) {
+  assert(index < kNumberOfKeys);
+  return kKeys[index];
+}
+
+uint64_t pieceKey(char figure, size_t line, size_t row) {
+  return kKeys[64 * getPieceKind(figure) + 8 * row + line];
+}
+
+// Keys of castlings, en passant and side to move.
+uint64_t hashState(const Board& board) {
+  uint64_t result = 0ull;
+  const Castling castlings[] = {Castling::K, Castling::Q, Castling::k, Castling::q};
+  for (size_t i = 0; i < 4; ++i) {
+    if (board.canCastle(castlings[i])) {
+      result ^= kKeys[kCastlingKeysOffset + i];
+    }
+  }
+  if (board.isEnPassantCapturePossible()) {
+    result ^= kKeys[kEnPassantKeysOffset + board.getEnPassantTargetSquare().letter - 'a'];
+  }
+  if (board.whiteToMove()) {
+    result ^= kKeys[kTurnKeyOffset];
+  }
+  return result;
+}
+
+uint64_t hash(const Board& board) {
+  uint64_t result = 0ull;
+  for (size_t line = 0; line < Board::kBoardSize; ++line) {
+    for (size_t row = 0; row < Board::kBoardSize; ++row) {
+      const char figure = board.at(line, row);
+      if (figure) {
+        result ^= pieceKey(figure, line, row);
+      }
+    }
+  }
+  return result ^ hashState(board);
+}
+
+uint64_t update(uint64_t hash, const Board& from, const Board& to) {
+  const char* old_squares = from.getSquares();
+  const char* new_squares = to.getSquares();
+  constexpr size_t kSquares = Board::kBoardSize * Board::kBoardSize;
+  for (size_t chunk = 0; chunk < kSquares; chunk += sizeof(uint64_t)) {
+    uint64_t old_chunk, new_chunk;
+    memcpy(&old_chunk, old_squares + chunk, sizeof(uint64_t));
+    memcpy(&new_chunk, new_squares + chunk, sizeof(uint64_t));
+    if (old_chunk == new_chunk) {
+      continue;
+    }
+    for (size_t index = chunk; index < chunk + sizeof(uint64_t); ++index) {
+      if (old_squares[index] == new_squares[index]) {
+        continue;
+      }
+      const size_t line = index / Board::kBoardSize;
+      const size_t row = index % Board::kBoardSize;
+      if (old_squares[index]) {
+        hash ^= pieceKey(old_squares[index], line, row);
+      }
+      if (new_squares[index]) {
+        hash ^= pieceKey(new_squares[index], line, row);
+      }
+    }
+  }
+  return hash ^ hashState(from) ^ hashState(to);
+}
+
+}  // namespace zobrist
@@ -0,0 +1,27 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Board.h"
+
+// Position hashing. Keys are laid out the same way as in Polyglot books:
+// 768 piece/square keys, 4 castling keys, 8 en passant file keys and
+// one side to move key.
+namespace zobrist {
+
+constexpr size_t kCastlingKeysOffset = 768;
+constexpr size_t kEnPassantKeysOffset = 772;
+constexpr size_t kTurnKeyOffset = 780;
+constexpr size_t kNumberOfKeys = 781;
+
+uint64_t key(size_t index);
+uint64_t pieceKey(char figure, size_t line, size_t row);
+uint64_t hash(const Board& board);
+// Hash of |to| calculated from |hash| of |from| and the squares which differ.
+uint64_t update(uint64_t hash, const Board& from, const Board& to);
+
+}  // namespace zobrist
+
+#endif  // ZOBRIST_H